@@ -0,0 +1,751 @@
+#include <vector>
+#include <array>
+#include <span>
+#include <deque>
+#include <list>
+#include <ranges>
+#include <algorithm>
+#include <iterator>
+#include <random>
+#include <functional>
+#include <thread>
+#include <sstream>
+#include <string>
+#include <regex>
+#include <filesystem>
+#include <fstream>
+#include <memory_resource>
+#include <tuple>
+#include <benchmark/benchmark.h>
+
+#if defined(USE_CONCEPTS)
+#include "filteriterator.hpp"
+#else
+#include "filteriterator_SFINAE.hpp"
+#endif
+#include "filteriterator_algorithm.hpp"
+#include "filteriterator_parallel.hpp"
+#include "filteriterator_prefetch.hpp"
+#include "filteriterator_mmap.hpp"
+#include "filteriterator_arena.hpp"
+#include "filteriterator_dsl.hpp"
+
+static std::vector<int> make_data(std::size_t n) {
+    std::vector<int> data(n);
+    std::mt19937 gen(42);
+    std::uniform_int_distribution<> distrib(1, 1000);
+    for (auto& v : data) {
+        v = distrib(gen);
+    }
+    return data;
+}
+
+template <class Range>
+static void consume(Range& range) {
+    std::size_t count = 0;
+    for (auto v : range) {
+        benchmark::DoNotOptimize(v);
+        ++count;
+    }
+    benchmark::DoNotOptimize(count);
+}
+
+static void BM_StdFunctionPredicate(benchmark::State& state) {
+    auto data = make_data(static_cast<std::size_t>(state.range(0)));
+    auto range = iterator::filter_range(data.begin(), data.end(), std::function<bool(const int&)>([](int v){ return v > 500; }));
+    for (auto _ : state) {
+        consume(range);
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_StdFunctionPredicate)->Arg(1 << 10)->Arg(1 << 16)->Arg(1 << 20);
+
+static void BM_LambdaPredicate(benchmark::State& state) {
+    auto data = make_data(static_cast<std::size_t>(state.range(0)));
+    auto range = iterator::filter_range(data.begin(), data.end(), [](int v){ return v > 500; });
+    for (auto _ : state) {
+        consume(range);
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_LambdaPredicate)->Arg(1 << 10)->Arg(1 << 16)->Arg(1 << 20);
+
+static void BM_CapturingLambdaPredicate(benchmark::State& state) {
+    auto data = make_data(static_cast<std::size_t>(state.range(0)));
+    int threshold = 500;
+    auto range = iterator::filter_range(data.begin(), data.end(), [threshold](int v){ return v > threshold; });
+    for (auto _ : state) {
+        consume(range);
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_CapturingLambdaPredicate)->Arg(1 << 10)->Arg(1 << 16)->Arg(1 << 20);
+
+template <class T>
+static void BM_ComparePredicate(benchmark::State& state) {
+    auto ints = make_data(static_cast<std::size_t>(state.range(0)));
+    std::vector<T> data;
+    for (int v : ints) {
+        data.push_back(static_cast<T>(v % 100));
+    }
+    iterator::simd::set_max_isa(static_cast<iterator::simd::isa>(state.range(1)));
+    auto range = iterator::filter_range(data.begin(), data.end(), iterator::pred::greater(T{90}));
+    for (auto _ : state) {
+        consume(range);
+    }
+    iterator::simd::set_max_isa(iterator::simd::isa::avx2);
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+// second argument: 0 = scalar, 1 = sse2, 2 = avx2
+BENCHMARK(BM_ComparePredicate<char>)->ArgsProduct({{1 << 16}, {0, 1, 2}});
+BENCHMARK(BM_ComparePredicate<int>)->ArgsProduct({{1 << 16}, {0, 1, 2}});
+BENCHMARK(BM_ComparePredicate<long>)->ArgsProduct({{1 << 16}, {0, 1, 2}});
+BENCHMARK(BM_ComparePredicate<double>)->ArgsProduct({{1 << 16}, {0, 1, 2}});
+
+static void BM_SequentialFilterCopy(benchmark::State& state) {
+    auto data = make_data(1 << 24);
+    auto range = iterator::filter_range(data.begin(), data.end(), [](int v){ return v > 500; });
+    for (auto _ : state) {
+        std::vector<int> result;
+        std::copy(range.begin(), range.end(), std::back_inserter(result));
+        benchmark::DoNotOptimize(result.data());
+    }
+    state.SetItemsProcessed(state.iterations() * static_cast<long long>(data.size()));
+}
+BENCHMARK(BM_SequentialFilterCopy)->Unit(benchmark::kMillisecond)->UseRealTime();
+
+static void BM_ParallelFilterCopy(benchmark::State& state) {
+    auto data = make_data(1 << 24);
+    for (auto _ : state) {
+        std::vector<int> result(data.size());
+        auto end = iterator::parallel_filter_copy(data.begin(), data.end(), result.begin(), [](int v){ return v > 500; },
+            static_cast<unsigned>(state.range(0)));
+        result.erase(end, result.end());
+        benchmark::DoNotOptimize(result.data());
+    }
+    state.SetItemsProcessed(state.iterations() * static_cast<long long>(data.size()));
+}
+BENCHMARK(BM_ParallelFilterCopy)->DenseRange(1, static_cast<int>(std::max(1u, std::thread::hardware_concurrency())))
+    ->Unit(benchmark::kMillisecond)->UseRealTime();
+
+// Matches and their cost are concentrated in the last eighth of the input.
+static void BM_ParallelForEachClustered(benchmark::State& state) {
+    std::vector<int> data(1 << 20, 0);
+    std::fill(data.end() - (1 << 17), data.end(), 1);
+    auto range = iterator::filter_range(data.begin(), data.end(), [](int v){ return v == 1; });
+    iterator::work_stealing_pool pool(static_cast<unsigned>(state.range(0)));
+    for (auto _ : state) {
+        // works on a copy: writing to the element would make it stop matching after the first run
+        iterator::parallel_for_each(range, [](int v) {
+            for (int i = 0; i < 200; ++i) {
+                benchmark::DoNotOptimize(v += i);
+            }
+        }, pool);
+    }
+    state.SetItemsProcessed(state.iterations() * static_cast<long long>(data.size()));
+}
+BENCHMARK(BM_ParallelForEachClustered)->DenseRange(1, static_cast<int>(std::max(1u, std::thread::hardware_concurrency())))
+    ->Unit(benchmark::kMillisecond)->UseRealTime();
+
+template <class Container>
+static void BM_FilterRangeView(benchmark::State& state) {
+    auto data = make_data(static_cast<std::size_t>(state.range(0)));
+    Container values(data.begin(), data.end());
+    for (auto _ : state) {
+        auto view = values | iterator::views::filter([](int v){ return v > 500; });
+        consume(view);
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_FilterRangeView<std::vector<int>>)->Arg(1 << 16);
+BENCHMARK(BM_FilterRangeView<std::deque<int>>)->Arg(1 << 16);
+BENCHMARK(BM_FilterRangeView<std::list<int>>)->Arg(1 << 16);
+
+template <class Container>
+static void BM_StdFilterView(benchmark::State& state) {
+    auto data = make_data(static_cast<std::size_t>(state.range(0)));
+    Container values(data.begin(), data.end());
+    for (auto _ : state) {
+        auto view = values | std::views::filter([](int v){ return v > 500; });
+        consume(view);
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_StdFilterView<std::vector<int>>)->Arg(1 << 16);
+BENCHMARK(BM_StdFilterView<std::deque<int>>)->Arg(1 << 16);
+BENCHMARK(BM_StdFilterView<std::list<int>>)->Arg(1 << 16);
+
+// Three conditions written as stacked filter_ranges (every level re-checks its own end and
+// calls through to the level below), fused with pred::all_of, and as one hand-written lambda.
+static void BM_NestedFilter(benchmark::State& state) {
+    auto data = make_data(static_cast<std::size_t>(state.range(0)));
+    auto above = [](int v){ return v > 200; };
+    auto even = [](int v){ return v % 2 == 0; };
+    auto below = [](int v){ return v < 900; };
+    auto first = iterator::filter_range(data.begin(), data.end(), above);
+    using first_iterator = decltype(first)::iterator;
+    auto second = iterator::filter_range<first_iterator, decltype(even)>(first.begin(), first.end(), even);
+    using second_iterator = decltype(second)::iterator;
+    auto third = iterator::filter_range<second_iterator, decltype(below)>(second.begin(), second.end(), below);
+    for (auto _ : state) {
+        consume(third);
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_NestedFilter)->Arg(1 << 16);
+
+static void BM_FusedFilter(benchmark::State& state) {
+    auto data = make_data(static_cast<std::size_t>(state.range(0)));
+    auto range = iterator::filter_range(data.begin(), data.end(), iterator::pred::all_of(
+        [](int v){ return v > 200; }, [](int v){ return v % 2 == 0; }, [](int v){ return v < 900; }));
+    for (auto _ : state) {
+        consume(range);
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_FusedFilter)->Arg(1 << 16);
+
+static void BM_HandWrittenConjunction(benchmark::State& state) {
+    auto data = make_data(static_cast<std::size_t>(state.range(0)));
+    auto range = iterator::filter_range(data.begin(), data.end(), [](int v){ return v > 200 && v % 2 == 0 && v < 900; });
+    for (auto _ : state) {
+        consume(range);
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_HandWrittenConjunction)->Arg(1 << 16);
+
+struct Record {
+    int id;
+    std::string name;
+};
+
+static std::vector<Record> make_records(std::size_t n) {
+    auto ids = make_data(n);
+    std::vector<Record> records;
+    records.reserve(n);
+    for (int id : ids) {
+        records.push_back({id, "record number " + std::to_string(id) + (id % 7 == 0 ? " archived" : " active")});
+    }
+    return records;
+}
+
+// The expensive regex search comes first although the cheap id check rejects 90%.
+static auto bad_order_terms() {
+    static const std::regex active("number [0-9]+ active");
+    return std::make_tuple([](const Record& r){ return std::regex_search(r.name, active); },
+        [](const Record& r){ return r.name.size() > 10; },
+        [](const Record& r){ return r.id > 900; });
+}
+
+static void BM_ConjunctionBadOrder(benchmark::State& state) {
+    auto records = make_records(static_cast<std::size_t>(state.range(0)));
+    auto range = iterator::filter_range(records.begin(), records.end(), std::apply([](auto... terms) {
+        return iterator::pred::all_of(terms...);
+    }, bad_order_terms()));
+    for (auto _ : state) {
+        consume(range);
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_ConjunctionBadOrder)->Arg(1 << 16);
+
+static void BM_ConjunctionAdaptive(benchmark::State& state) {
+    auto records = make_records(static_cast<std::size_t>(state.range(0)));
+    auto range = iterator::filter_range(records.begin(), records.end(), std::apply([](auto... terms) {
+        return iterator::pred::adaptive_all_of(terms...);
+    }, bad_order_terms()));
+    for (auto _ : state) {
+        consume(range);
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_ConjunctionAdaptive)->Arg(1 << 16);
+
+static void BM_ConjunctionBestOrder(benchmark::State& state) {
+    auto records = make_records(static_cast<std::size_t>(state.range(0)));
+    auto range = iterator::filter_range(records.begin(), records.end(), std::apply([](auto find, auto size, auto id) {
+        return iterator::pred::all_of(id, size, find);
+    }, bad_order_terms()));
+    for (auto _ : state) {
+        consume(range);
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_ConjunctionBestOrder)->Arg(1 << 16);
+
+// Branchy copy_if against the branchless copy and the probing filter_copy, over uniform
+// random values, so the argument is the selectivity in percent.
+template <class T>
+static std::vector<T> make_percent_data(std::size_t n) {
+    std::vector<T> data(n);
+    std::mt19937 gen(42);
+    std::uniform_int_distribution<> distrib(0, 99);
+    for (auto& v : data) {
+        v = static_cast<T>(distrib(gen));
+    }
+    return data;
+}
+
+template <class T>
+static void BM_CopyIf(benchmark::State& state) {
+    auto data = make_percent_data<T>(1 << 16);
+    std::vector<T> result(data.size());
+    const auto threshold = static_cast<T>(state.range(0));
+    for (auto _ : state) {
+        auto end = std::copy_if(data.begin(), data.end(), result.begin(), [threshold](T v){ return v < threshold; });
+        benchmark::DoNotOptimize(end);
+        benchmark::ClobberMemory();
+    }
+    state.SetItemsProcessed(state.iterations() * static_cast<long long>(data.size()));
+}
+
+template <class T>
+static void BM_FilterCopyBranchless(benchmark::State& state) {
+    auto data = make_percent_data<T>(1 << 16);
+    std::vector<T> result(data.size());
+    const auto threshold = static_cast<T>(state.range(0));
+    for (auto _ : state) {
+        auto end = iterator::filter_copy_branchless(data.begin(), data.end(), result.begin(), [threshold](T v){ return v < threshold; });
+        benchmark::DoNotOptimize(end);
+        benchmark::ClobberMemory();
+    }
+    state.SetItemsProcessed(state.iterations() * static_cast<long long>(data.size()));
+}
+
+template <class T>
+static void BM_FilterCopyProbed(benchmark::State& state) {
+    auto data = make_percent_data<T>(1 << 16);
+    std::vector<T> result(data.size());
+    const auto threshold = static_cast<T>(state.range(0));
+    for (auto _ : state) {
+        auto end = iterator::filter_copy(data.begin(), data.end(), result.begin(), [threshold](T v){ return v < threshold; });
+        benchmark::DoNotOptimize(end);
+        benchmark::ClobberMemory();
+    }
+    state.SetItemsProcessed(state.iterations() * static_cast<long long>(data.size()));
+}
+
+BENCHMARK(BM_CopyIf<int>)->DenseRange(0, 100, 10);
+BENCHMARK(BM_FilterCopyBranchless<int>)->DenseRange(0, 100, 10);
+BENCHMARK(BM_FilterCopyProbed<int>)->DenseRange(0, 100, 10);
+BENCHMARK(BM_CopyIf<double>)->DenseRange(0, 100, 10);
+BENCHMARK(BM_FilterCopyBranchless<double>)->DenseRange(0, 100, 10);
+BENCHMARK(BM_FilterCopyProbed<double>)->DenseRange(0, 100, 10);
+
+// Matches pulled in batches of 256 addresses, as the downstream consumers do.
+static void BM_NextBatch(benchmark::State& state) {
+    auto data = make_data(static_cast<std::size_t>(state.range(0)));
+    auto range = iterator::filter_range(data.begin(), data.end(), [](int v){ return v > 500; });
+    std::array<int*, 256> batch{};
+    for (auto _ : state) {
+        long sum = 0;
+        for (auto it = range.begin(); it != range.end();) {
+            std::size_t n = it.next_batch(std::span(batch));
+            for (std::size_t i = 0; i < n; ++i) {
+                sum += *batch[i];
+            }
+        }
+        benchmark::DoNotOptimize(sum);
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_NextBatch)->Arg(1 << 16);
+
+static void BM_SingleStep(benchmark::State& state) {
+    auto data = make_data(static_cast<std::size_t>(state.range(0)));
+    auto range = iterator::filter_range(data.begin(), data.end(), [](int v){ return v > 500; });
+    for (auto _ : state) {
+        long sum = 0;
+        for (int v : range) {
+            sum += v;
+        }
+        benchmark::DoNotOptimize(sum);
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_SingleStep)->Arg(1 << 16);
+
+struct CustomStruct {
+    int id;
+    std::string name;
+};
+
+// Nodes are linked in an order unrelated to their addresses, so every step misses cache.
+static std::list<CustomStruct> make_shuffled_list(std::size_t n) {
+    std::list<CustomStruct> nodes;
+    for (std::size_t i = 0; i < n; ++i) {
+        nodes.push_back({static_cast<int>(i % 1000), "customer " + std::to_string(i)});
+    }
+    std::vector<std::list<CustomStruct>::iterator> order;
+    for (auto it = nodes.begin(); it != nodes.end(); ++it) {
+        order.push_back(it);
+    }
+    std::shuffle(order.begin(), order.end(), std::mt19937(42));
+    std::list<CustomStruct> shuffled;
+    for (auto it : order) {
+        shuffled.splice(shuffled.end(), nodes, it);
+    }
+    return shuffled;
+}
+
+// The argument is the prefetch distance, -1 for no prefetching and 0 for auto-tuning.
+static void BM_ShuffledListPrefetch(benchmark::State& state) {
+    auto list = make_shuffled_list(static_cast<std::size_t>(state.range(0)));
+    auto pred = [](const CustomStruct& s){ return s.id > 900; };
+    for (auto _ : state) {
+        std::size_t matches = 0;
+        if (state.range(1) < 0) {
+            for (const auto& s : iterator::filter_range(list.begin(), list.end(), pred)) {
+                benchmark::DoNotOptimize(s);
+                ++matches;
+            }
+        } else {
+            for (const auto& s : list | iterator::views::prefetch(static_cast<std::size_t>(state.range(1))) | iterator::views::filter(pred)) {
+                benchmark::DoNotOptimize(s);
+                ++matches;
+            }
+        }
+        benchmark::DoNotOptimize(matches);
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_ShuffledListPrefetch)->ArgsProduct({{1 << 20}, {-1, 0, 2, 4, 8, 16, 32}})->Unit(benchmark::kMillisecond);
+
+// size() of a pred::compare range popcounts 64-element masks; the lambda is counted one call at a time.
+static void BM_SizeCompare(benchmark::State& state) {
+    auto data = make_data(static_cast<std::size_t>(state.range(0)));
+    auto range = iterator::filter_range(data.begin(), data.end(), iterator::pred::greater(500));
+    for (auto _ : state) {
+        range.invalidate();
+        benchmark::DoNotOptimize(range.size());
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_SizeCompare)->Arg(1 << 16);
+
+static void BM_SizeLambda(benchmark::State& state) {
+    auto data = make_data(static_cast<std::size_t>(state.range(0)));
+    auto range = iterator::filter_range(data.begin(), data.end(), [](int v){ return v > 500; });
+    for (auto _ : state) {
+        range.invalidate();
+        benchmark::DoNotOptimize(range.size());
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_SizeLambda)->Arg(1 << 16);
+
+static std::string make_stream_text(std::size_t n) {
+    std::string text;
+    for (int v : make_data(n)) {
+        text += std::to_string(v);
+        text += ' ';
+    }
+    return text;
+}
+
+// Single-pass filtering straight from the stream, against buffering the stream into a vector first.
+static void BM_StreamFilter(benchmark::State& state) {
+    const auto text = make_stream_text(static_cast<std::size_t>(state.range(0)));
+    for (auto _ : state) {
+        std::istringstream in(text);
+        long sum = 0;
+        for (int v : iterator::filter_range(std::istream_iterator<int>(in), std::istream_iterator<int>(), [](int x){ return x > 500; })) {
+            sum += v;
+        }
+        benchmark::DoNotOptimize(sum);
+    }
+    state.SetBytesProcessed(state.iterations() * static_cast<long long>(text.size()));
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_StreamFilter)->Arg(1 << 16);
+
+static void BM_StreamBuffered(benchmark::State& state) {
+    const auto text = make_stream_text(static_cast<std::size_t>(state.range(0)));
+    for (auto _ : state) {
+        std::istringstream in(text);
+        std::vector<int> buffer(std::istream_iterator<int>(in), std::istream_iterator<int>{});
+        long sum = 0;
+        for (int v : iterator::filter_range(buffer.begin(), buffer.end(), [](int x){ return x > 500; })) {
+            sum += v;
+        }
+        benchmark::DoNotOptimize(sum);
+    }
+    state.SetBytesProcessed(state.iterations() * static_cast<long long>(text.size()));
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_StreamBuffered)->Arg(1 << 16);
+
+// Binary file of ints in the temporary directory, written once per run and removed at exit.
+static const std::filesystem::path& record_file(std::size_t n) {
+    static const struct file {
+        std::filesystem::path path;
+        explicit file(std::size_t count): path(std::filesystem::temp_directory_path() / "filteriterator_bench_records.bin") {
+            auto data = make_data(count);
+            std::ofstream out(path, std::ios::binary);
+            out.write(reinterpret_cast<const char*>(data.data()), static_cast<std::streamsize>(data.size() * sizeof(int)));
+        }
+        ~file() {
+            std::error_code ignored;
+            std::filesystem::remove(path, ignored);
+        }
+    } records(n);
+    return records.path;
+}
+
+// Filters the records in place in the page cache; the argument selects the madvise hints.
+static void BM_MmapRecords(benchmark::State& state) {
+    const auto& path = record_file(1 << 24);
+    const bool hinted = state.range(0) != 0;
+    std::size_t bytes = 0;
+    for (auto _ : state) {
+        iterator::mmap_record_range<int> records(path, {.sequential = hinted, .will_need = hinted, .huge_pages = hinted});
+        auto range = iterator::filter_range(records.begin(), records.end(), iterator::pred::greater(500));
+        benchmark::DoNotOptimize(range.size());
+        bytes = records.size() * sizeof(int);
+    }
+    state.SetBytesProcessed(state.iterations() * static_cast<long long>(bytes));
+}
+BENCHMARK(BM_MmapRecords)->Arg(0)->Arg(1)->Unit(benchmark::kMillisecond);
+
+// The previous approach: read the whole file into a vector, then filter it.
+static void BM_ReadRecords(benchmark::State& state) {
+    const auto& path = record_file(1 << 24);
+    std::size_t bytes = 0;
+    for (auto _ : state) {
+        std::ifstream in(path, std::ios::binary);
+        std::vector<int> records(std::filesystem::file_size(path) / sizeof(int));
+        in.read(reinterpret_cast<char*>(records.data()), static_cast<std::streamsize>(records.size() * sizeof(int)));
+        auto range = iterator::filter_range(records.begin(), records.end(), iterator::pred::greater(500));
+        benchmark::DoNotOptimize(range.size());
+        bytes = records.size() * sizeof(int);
+    }
+    state.SetBytesProcessed(state.iterations() * static_cast<long long>(bytes));
+}
+BENCHMARK(BM_ReadRecords)->Unit(benchmark::kMillisecond);
+
+// One hot int and a cold payload the size of a cache line, like a CustomStruct with a long name.
+struct HotColdRecord {
+    int id;
+    char payload[60];
+};
+
+static std::vector<HotColdRecord> make_hot_cold(std::size_t n) {
+    std::vector<HotColdRecord> records(n);
+    auto ids = make_data(n);
+    for (std::size_t i = 0; i < n; ++i) {
+        records[i].id = ids[i];
+        records[i].payload[0] = static_cast<char>(i);
+    }
+    return records;
+}
+
+// The argument selects the predicate: 0 a lambda on the whole record, 1 the same lambda on the
+// projected id, 2 pred::greater projected onto the id, which takes the strided block kernel.
+static void BM_ProjectedField(benchmark::State& state) {
+    auto records = make_hot_cold(static_cast<std::size_t>(state.range(0)));
+    auto count = [&state](auto&& range) {
+        for (auto _ : state) {
+            range.invalidate();
+            benchmark::DoNotOptimize(range.size());
+        }
+    };
+    switch (state.range(1)) {
+        case 0:
+            count(iterator::filter_range(records.begin(), records.end(), [](const HotColdRecord& r){ return r.id > 500; }));
+            break;
+        case 1:
+            count(iterator::filter_range(records.begin(), records.end(), [](int id){ return id > 500; }, &HotColdRecord::id));
+            break;
+        default:
+            count(iterator::filter_range(records.begin(), records.end(), iterator::pred::greater(500), &HotColdRecord::id));
+            break;
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_ProjectedField)->ArgsProduct({{1 << 16, 1 << 22}, {0, 1, 2}});
+
+// Same on a CustomStruct-like record with a std::string, iterating the matches.
+static void BM_ProjectedCustomStruct(benchmark::State& state) {
+    std::vector<CustomStruct> records;
+    for (int id : make_data(static_cast<std::size_t>(state.range(0)))) {
+        records.push_back({id, "customer " + std::to_string(id)});
+    }
+    auto iterate = [&state](auto&& range) {
+        for (auto _ : state) {
+            range.invalidate();
+            for (const auto& r : range) {
+                benchmark::DoNotOptimize(r);
+            }
+        }
+    };
+    if (state.range(1) == 0) {
+        iterate(iterator::filter_range(records.begin(), records.end(), [](const CustomStruct& r){ return r.id > 900; }));
+    } else {
+        iterate(iterator::filter_range(records.begin(), records.end(), iterator::pred::greater(900), &CustomStruct::id));
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_ProjectedCustomStruct)->ArgsProduct({{1 << 16}, {0, 1}});
+
+// Routes 1M ints to N buckets by value in one partition_into pass; the outputs are large
+// enough for every element, so the run measures the routing, not reallocation.
+template<std::size_t N>
+static void BM_PartitionInto(benchmark::State& state) {
+    auto data = make_data(1 << 20);
+    std::array<std::vector<int>, N> buckets;
+    std::array<int*, N> outs{};
+    for (std::size_t b = 0; b < N; ++b) {
+        buckets[b].resize(data.size());
+        outs[b] = buckets[b].data();
+    }
+    for (auto _ : state) {
+        auto ends = std::apply([&data](auto... out) {
+            return iterator::partition_into(data.begin(), data.end(), [](int v){ return static_cast<std::size_t>(v) % N; }, out...);
+        }, outs);
+        benchmark::DoNotOptimize(ends);
+        benchmark::ClobberMemory();
+    }
+    state.SetItemsProcessed(state.iterations() * static_cast<long long>(data.size()));
+}
+BENCHMARK(BM_PartitionInto<2>);
+BENCHMARK(BM_PartitionInto<8>);
+BENCHMARK(BM_PartitionInto<64>);
+
+template<std::size_t N>
+static void BM_PartitionIntoCombined(benchmark::State& state) {
+    auto data = make_data(1 << 20);
+    std::array<std::vector<int>, N> buckets;
+    std::array<int*, N> outs{};
+    for (std::size_t b = 0; b < N; ++b) {
+        buckets[b].resize(data.size());
+        outs[b] = buckets[b].data();
+    }
+    for (auto _ : state) {
+        auto ends = std::apply([&data](auto... out) {
+            return iterator::partition_into_combined(data.begin(), data.end(), [](int v){ return static_cast<std::size_t>(v) % N; }, out...);
+        }, outs);
+        benchmark::DoNotOptimize(ends);
+        benchmark::ClobberMemory();
+    }
+    state.SetItemsProcessed(state.iterations() * static_cast<long long>(data.size()));
+}
+BENCHMARK(BM_PartitionIntoCombined<2>);
+BENCHMARK(BM_PartitionIntoCombined<8>);
+BENCHMARK(BM_PartitionIntoCombined<64>);
+
+// The same buckets built with one filter_range per bucket, reading the data N times.
+template<std::size_t N>
+static void BM_PartitionFilterPasses(benchmark::State& state) {
+    auto data = make_data(1 << 20);
+    std::array<std::vector<int>, N> buckets;
+    for (auto& bucket : buckets) {
+        bucket.resize(data.size());
+    }
+    for (auto _ : state) {
+        for (std::size_t b = 0; b < N; ++b) {
+            auto range = iterator::filter_range(data.begin(), data.end(), [b](int v){ return static_cast<std::size_t>(v) % N == b; });
+            benchmark::DoNotOptimize(std::copy(range.begin(), range.end(), buckets[b].begin()));
+        }
+        benchmark::ClobberMemory();
+    }
+    state.SetItemsProcessed(state.iterations() * static_cast<long long>(data.size()));
+}
+BENCHMARK(BM_PartitionFilterPasses<2>);
+BENCHMARK(BM_PartitionFilterPasses<8>);
+BENCHMARK(BM_PartitionFilterPasses<64>);
+
+// Five passes over the matches of one filter: re-filtering every pass, against decoding
+// the positions once with select_indices and reusing them.
+static void BM_ReusedFilterPasses(benchmark::State& state) {
+    auto data = make_data(static_cast<std::size_t>(state.range(0)));
+    auto range = iterator::filter_range(data.begin(), data.end(), iterator::pred::greater(900));
+    for (auto _ : state) {
+        long sum = 0;
+        if (state.range(1) == 0) {
+            for (int pass = 0; pass < 5; ++pass) {
+                range.invalidate();
+                for (int v : range) {
+                    sum += v;
+                }
+            }
+        } else {
+            range.invalidate();
+            auto positions = range.select_indices();
+            for (int pass = 0; pass < 5; ++pass) {
+                for (auto i : positions) {
+                    sum += data[i];
+                }
+            }
+        }
+        benchmark::DoNotOptimize(sum);
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_ReusedFilterPasses)->ArgsProduct({{1 << 20}, {0, 1}});
+
+// Collecting the matches: 0 back_inserter into a vector as the tests do, 1 to<std::vector>,
+// 2 to<std::pmr::vector> on an arena that is reset per iteration like a per-request arena.
+// The second argument selects a lambda (sampled reservation) or pred::greater (exact count).
+static void BM_Materialize(benchmark::State& state) {
+    auto data = make_data(1 << 20);
+    iterator::arena arena;
+    auto run = [&](auto&& range) {
+        for (auto _ : state) {
+            range.invalidate();
+            if (state.range(0) == 0) {
+                std::vector<int> out;
+                std::copy(range.begin(), range.end(), std::back_inserter(out));
+                benchmark::DoNotOptimize(out.data());
+            } else if (state.range(0) == 1) {
+                auto out = range.template to<std::vector<int>>();
+                benchmark::DoNotOptimize(out.data());
+            } else {
+                arena.reset();
+                auto out = range.template to<std::pmr::vector<int>>(&arena);
+                benchmark::DoNotOptimize(out.data());
+            }
+        }
+    };
+    if (state.range(1) == 0) {
+        run(iterator::filter_range(data.begin(), data.end(), [](int v){ return v > 500; }));
+    } else {
+        run(iterator::filter_range(data.begin(), data.end(), iterator::pred::greater(500)));
+    }
+    state.SetItemsProcessed(state.iterations() * static_cast<long long>(data.size()));
+}
+BENCHMARK(BM_Materialize)->ArgsProduct({{0, 1, 2}, {0, 1}});
+
+// _1 > 500 && _1 < 900 against the same test as a lambda, iterated and counted
+static void BM_DslBetween(benchmark::State& state) {
+    using namespace iterator::dsl;
+    auto data = make_data(static_cast<std::size_t>(state.range(0)));
+    auto range = iterator::filter_range(data.begin(), data.end(), _1 > 500 && _1 < 900);
+    for (auto _ : state) {
+        range.invalidate();
+        if (state.range(1) == 0) {
+            consume(range);
+        } else {
+            benchmark::DoNotOptimize(range.size());
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_DslBetween)->ArgsProduct({{1 << 16}, {0, 1}});
+
+static void BM_LambdaBetween(benchmark::State& state) {
+    auto data = make_data(static_cast<std::size_t>(state.range(0)));
+    auto range = iterator::filter_range(data.begin(), data.end(), [](int v){ return v > 500 && v < 900; });
+    for (auto _ : state) {
+        range.invalidate();
+        if (state.range(1) == 0) {
+            consume(range);
+        } else {
+            benchmark::DoNotOptimize(range.size());
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_LambdaBetween)->ArgsProduct({{1 << 16}, {0, 1}});
+
+BENCHMARK_MAIN();
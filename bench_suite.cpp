@@ -0,0 +1,139 @@
+#include <vector>
+#include <deque>
+#include <list>
+#include <memory>
+#include <random>
+#include <string>
+#include <benchmark/benchmark.h>
+
+#if defined(USE_CONCEPTS)
+#include "filteriterator.hpp"
+#else
+#include "filteriterator_SFINAE.hpp"
+#endif
+
+// Baseline matrix: every container of the tests, every element type of MyParams plus
+// CustomStruct, selectivities from 0 to 100% with matches spread at random or clustered
+// in runs. Reports ns per input element and input bytes per second.
+
+namespace {
+    constexpr std::size_t suite_size = 1 << 16;
+    constexpr std::size_t cluster = 256;
+
+    struct CustomStruct {
+        int id;
+        std::string name;
+    };
+
+    enum class layout { random, clustered };
+
+    std::vector<bool> make_matches(std::size_t n, int percent, layout kind) {
+        std::vector<bool> matches(n);
+        std::mt19937 gen(42);
+        std::bernoulli_distribution match(percent / 100.0);
+        if (kind == layout::random) {
+            for (std::size_t i = 0; i < n; ++i) {
+                matches[i] = match(gen);
+            }
+        } else {
+            for (std::size_t b = 0; b < n; b += cluster) {
+                bool hit = match(gen);
+                for (std::size_t i = b; i < std::min(n, b + cluster); ++i) {
+                    matches[i] = hit;
+                }
+            }
+        }
+        return matches;
+    }
+
+    // Matches are positive, the others zero.
+    template<class T>
+    std::vector<T> make_values(const std::vector<bool>& matches) {
+        std::vector<T> values;
+        values.reserve(matches.size());
+        for (std::size_t i = 0; i < matches.size(); ++i) {
+            if constexpr (std::is_same_v<T, CustomStruct>) {
+                int id = matches[i] ? static_cast<int>(i % 100) + 1 : 0;
+                values.push_back({id, "customer " + std::to_string(i)});
+            } else {
+                values.push_back(matches[i] ? static_cast<T>(i % 100 + 1) : T{});
+            }
+        }
+        return values;
+    }
+
+    template<class T>
+    bool is_match(const T& v) {
+        if constexpr (std::is_same_v<T, CustomStruct>) {
+            return v.id > 0;
+        } else {
+            return v > T{};
+        }
+    }
+
+    // Heap array walked through plain pointers, like the C arrays of the tests.
+    template<class T>
+    struct c_array {
+        c_array(typename std::vector<T>::const_iterator first, typename std::vector<T>::const_iterator last)
+            : size(static_cast<std::size_t>(last - first)), data(std::make_unique<T[]>(size)) {
+            std::copy(first, last, data.get());
+        }
+        T* begin() {return data.get();}
+        T* end() {return data.get() + size;}
+
+        std::size_t size;
+        std::unique_ptr<T[]> data;
+    };
+
+    template<class Container, class T>
+    void BM_Suite(benchmark::State& state, layout kind) {
+        auto values = make_values<T>(make_matches(suite_size, static_cast<int>(state.range(0)), kind));
+        Container data(values.cbegin(), values.cend());
+        auto range = iterator::filter_range(data.begin(), data.end(), [](const T& v){ return is_match(v); });
+        for (auto _ : state) {
+            range.invalidate();
+            for (auto&& v : range) {
+                benchmark::DoNotOptimize(v);
+            }
+        }
+        const auto elements = static_cast<double>(suite_size);
+        state.counters["ns_per_element"] = benchmark::Counter(elements * 1e-9,
+            benchmark::Counter::kIsIterationInvariantRate | benchmark::Counter::kInvert);
+        state.SetBytesProcessed(state.iterations() * static_cast<long long>(suite_size * sizeof(T)));
+        state.SetItemsProcessed(state.iterations() * static_cast<long long>(suite_size));
+    }
+
+    template<template<class> class Container, class T>
+    void register_suite(const std::string& container, const std::string& type) {
+        for (auto [kind, name] : {std::pair{layout::random, "random"}, std::pair{layout::clustered, "clustered"}}) {
+            benchmark::RegisterBenchmark(("BM_Suite/" + container + "/" + type + "/" + name).c_str(),
+                [kind = kind](benchmark::State& state) {BM_Suite<Container<T>, T>(state, kind);})
+                ->ArgName("selectivity")->Arg(0)->Arg(1)->Arg(10)->Arg(50)->Arg(90)->Arg(99)->Arg(100);
+        }
+    }
+
+    template<class T> using vector_of = std::vector<T>;
+    template<class T> using deque_of = std::deque<T>;
+    template<class T> using list_of = std::list<T>;
+
+    template<class T>
+    void register_type(const std::string& type) {
+        register_suite<vector_of, T>("vector", type);
+        register_suite<deque_of, T>("deque", type);
+        register_suite<list_of, T>("list", type);
+        register_suite<c_array, T>("c_array", type);
+    }
+
+    const bool registered = [] {
+        register_type<char>("char");
+        register_type<unsigned char>("unsigned_char");
+        register_type<short>("short");
+        register_type<unsigned short>("unsigned_short");
+        register_type<int>("int");
+        register_type<long>("long");
+        register_type<float>("float");
+        register_type<double>("double");
+        register_type<CustomStruct>("CustomStruct");
+        return true;
+    }();
+}
@@ -1,88 +1,833 @@
 #ifndef FILTERITERATOR_HPP
 #define FILTERITERATOR_HPP
 
+#include <array>
+#include <cstdint>
 #include <iterator>
 #include <type_traits>
 #include <concepts>
 #include <stdexcept>
 #include <functional>
+#include <limits>
+#include <memory>
+#include <optional>
+#include <ranges>
+#include <span>
+#include <utility>
+#include <vector>
+
+#include "filteriterator_pred.hpp"
+#include "filteriterator_simd.hpp"
+#include "filteriterator_stats.hpp"
 
 namespace iterator {
     namespace Impl {
+        struct no_scan_t { explicit no_scan_t() = default; };
+        inline constexpr no_scan_t no_scan{};
+
+        struct no_first {};
+
+        // An empty, default-constructible predicate carries no state, so iterators can make their
+        // own instance instead of pointing back into the range (which makes the range borrowed).
+        template<class Predicate>
+        inline constexpr bool is_stateless_v = std::is_empty_v<Predicate> && std::is_default_constructible_v<Predicate>;
+
+        template<class Predicate, class = void>
+        class pred_handle {
+        public:
+            pred_handle() = default;
+            explicit constexpr pred_handle(Predicate& pred) noexcept: pred_(&pred) {}
+
+            constexpr Predicate& get() const noexcept {return *pred_;}
+
+        private:
+            Predicate* pred_ = nullptr;
+        };
+
+        template<class Predicate>
+        class pred_handle<Predicate, std::enable_if_t<is_stateless_v<Predicate>>> {
+        public:
+            pred_handle() = default;
+            explicit constexpr pred_handle(Predicate&) noexcept {}
+
+            constexpr Predicate get() const noexcept {return Predicate{};}
+        };
+
+        // pred::per_iterator: every iterator calls its own copy of the predicate.
+        template<class Predicate>
+        class pred_handle<Predicate, std::enable_if_t<pred::Impl::is_kind_v<pred::per_iterator_t, Predicate> && !is_stateless_v<Predicate>>> {
+        public:
+            pred_handle() = default;
+            explicit constexpr pred_handle(const Predicate& pred) noexcept(std::is_nothrow_copy_constructible_v<Predicate>): pred_(std::in_place, pred) {}
+            pred_handle(const pred_handle&) = default;
+            constexpr pred_handle& operator=(const pred_handle& other) {
+                if (this != &other) {
+                    pred_.reset();
+                    if (other.pred_) {
+                        pred_.emplace(*other.pred_);
+                    }
+                }
+                return *this;
+            }
+
+            constexpr Predicate& get() const noexcept {return *pred_;}
+
+        private:
+            mutable std::optional<Predicate> pred_;
+        };
+
+        // Predicates that iterators on several threads may call at the same time, because no two
+        // iterators call the same mutable object: see filter_range::begin() const.
+        template<class Predicate>
+        inline constexpr bool is_shareable_v = is_stateless_v<Predicate> || pred::Impl::is_kind_v<pred::per_iterator_t, Predicate>
+            || pred::Impl::is_kind_v<pred::const_call_t, Predicate>;
+
+        // Makes closures (whose copy assignment is deleted) assignable, as ranges::view requires.
+        template<class T, class = void>
+        class assignable_box {
+        public:
+            explicit constexpr assignable_box(T value): value_(std::move(value)) {}
+
+            constexpr T& get() noexcept {return value_;}
+            constexpr const T& get() const noexcept {return value_;}
+
+        private:
+            T value_;
+        };
+
+        template<class T>
+        class assignable_box<T, std::enable_if_t<!std::is_copy_assignable_v<T>>> {
+        public:
+            explicit constexpr assignable_box(T value): value_(std::in_place, std::move(value)) {}
+            assignable_box(const assignable_box&) = default;
+            assignable_box(assignable_box&&) = default;
+            constexpr assignable_box& operator=(const assignable_box& other) {
+                if (this != &other) {
+                    value_.reset();
+                    value_.emplace(*other.value_);
+                }
+                return *this;
+            }
+            constexpr assignable_box& operator=(assignable_box&& other) noexcept(std::is_nothrow_move_constructible_v<T>) {
+                if (this != &other) {
+                    value_.reset();
+                    value_.emplace(std::move(*other.value_));
+                }
+                return *this;
+            }
+
+            constexpr T& get() noexcept {return *value_;}
+            constexpr const T& get() const noexcept {return *value_;}
+
+        private:
+            std::optional<T> value_;
+        };
+
+        template<class Iterator>
+        inline constexpr bool is_bidirectional_v = std::bidirectional_iterator<Iterator>;
+        template<class Iterator>
+        inline constexpr bool is_forward_v = std::forward_iterator<Iterator>;
+
+        template<class Container, class = void>
+        inline constexpr bool has_reserve_v = false;
+        template<class Container>
+        inline constexpr bool has_reserve_v<Container, std::void_t<decltype(std::declval<Container&>().reserve(std::size_t{}))>> = true;
+
     template<class Iterator>
-    concept ValidIter = std::is_base_of_v<std::forward_iterator_tag, typename std::iterator_traits<Iterator>::iterator_category> && requires(Iterator it)
+    concept ValidIter = std::is_base_of_v<std::input_iterator_tag, typename std::iterator_traits<Iterator>::iterator_category> && requires(Iterator it)
     {
         ++it;
         *it;
         it == it;
     };
 
-        template<class Iterator, class Predicate>
+        template<class Sentinel>
+        class filter_sentinel {
+        public:
+            filter_sentinel() = default;
+            explicit constexpr filter_sentinel(Sentinel last): last_(last) {}
+
+            constexpr const Sentinel& base() const noexcept {return last_;}
+
+        private:
+            Sentinel last_{};
+        };
+
+        template<class Iterator, class Predicate, class Sentinel = Iterator, class Stats = no_stats>
         class filter_iterator {
         public:
             using value_type        = typename std::iterator_traits<Iterator>::value_type;
             using reference         = typename std::iterator_traits<Iterator>::reference;
             using pointer           = typename std::iterator_traits<Iterator>::pointer;
             using difference_type   = typename std::iterator_traits<Iterator>::difference_type;
-            using iterator_category = std::forward_iterator_tag;
+            using iterator_concept  = std::conditional_t<is_bidirectional_v<Iterator>, std::bidirectional_iterator_tag, std::forward_iterator_tag>;
+            // like std::ranges::filter_view, bases that yield prvalues (e.g. std::views::transform)
+            // only meet the C++17 input iterator requirements
+            using iterator_category = std::conditional_t<std::is_lvalue_reference_v<reference>, iterator_concept, std::input_iterator_tag>;
 
             filter_iterator() = default;
-            filter_iterator(Iterator current, Iterator last, Predicate& pred): current_(current), last_(last), pred_(pred) {
+            constexpr filter_iterator(Iterator first, Iterator current, Sentinel last, Predicate& pred, stats_handle<Stats> stats = {})
+                : current_(current), last_(last), first_(make_first(first)), pred_(pred), cursor_(pred), stats_(stats) {
                 find_next_valid();
             }
+            // current must already be a match (or last)
+            constexpr filter_iterator(Iterator first, Iterator current, Sentinel last, Predicate& pred, no_scan_t, stats_handle<Stats> stats = {})
+                : current_(current), last_(last), first_(make_first(first)), pred_(pred), cursor_(pred), stats_(stats) {
+                if constexpr (use_kernel) {
+                    if (!std::is_constant_evaluated()) {
+                        cursor_.restart_after(std::to_address(current_), std::to_address(last_));
+                    }
+                }
+            }
 
-            reference operator*() const {return *current_;}
-            pointer operator->() const {return &(*current_);}
+            constexpr reference operator*() const {return *current_;}
+            constexpr pointer operator->() const {return &(*current_);}
 
-            filter_iterator& operator++() {
+            constexpr filter_iterator& operator++() {
                 if (current_ != last_) {
+                    if constexpr (use_kernel) {
+                        if (!std::is_constant_evaluated()) {
+                            auto next = cursor_.next(std::to_address(last_), stats_.counted(pred_.get()));
+                            stats_.scan(static_cast<std::size_t>(next - std::to_address(current_)) - 1, next != std::to_address(last_));
+                            current_ = from_address(next);
+                            return *this;
+                        }
+                    }
                     ++current_;
                     find_next_valid();
                 }
                 return *this;
             };
-            filter_iterator  operator++(int) {
+            constexpr filter_iterator  operator++(int) {
                 filter_iterator tmp = *this;
                 ++(*this);
                 return tmp;
             };
+            constexpr filter_iterator& operator--() requires is_bidirectional_v<Iterator> {
+                find_prev_valid();
+                return *this;
+            };
+            constexpr filter_iterator  operator--(int) requires is_bidirectional_v<Iterator> {
+                filter_iterator tmp = *this;
+                --(*this);
+                return tmp;
+            };
+
+            // Stores the addresses of up to out.size() matches, starting with the current one, and
+            // leaves the iterator on the first match not stored. Returns how many were stored.
+            std::size_t next_batch(std::span<pointer> out) {
+                return gather(out.size(), [&out](std::size_t n, const Iterator& it) {out[n] = &(*it);});
+            }
+            // Same for random-access bases, storing positions relative to the start of the range.
+            std::size_t next_batch(std::span<std::size_t> out) requires std::random_access_iterator<Iterator> {
+                return gather(out.size(), [this, &out](std::size_t n, const Iterator& it) {out[n] = static_cast<std::size_t>(it - first_);});
+            }
+
+            constexpr const Iterator& base() const noexcept {return current_;}
+            constexpr decltype(auto) pred() const noexcept {return pred_.get();}
+            constexpr stats_handle<Stats> stats() const noexcept {return stats_;}
 
-            bool operator==(const filter_iterator& other) const noexcept {return current_ == other.current_;}
-            bool operator!=(const filter_iterator& other) const noexcept{return !(*this==other);}
+            constexpr bool operator==(const filter_iterator& other) const noexcept {return current_ == other.current_;}
+            constexpr bool operator!=(const filter_iterator& other) const noexcept{return !(*this==other);}
+            friend constexpr bool operator==(const filter_iterator& it, const filter_sentinel<Sentinel>& last) {return it.current_ == last.base();}
 
         private:
-            void find_next_valid() {
-                while (current_ != last_ && !pred_(*current_)) {
+            static constexpr bool use_kernel = simd::is_kernel_v<Iterator, Predicate> && std::is_same_v<Iterator, Sentinel>;
+
+            constexpr void find_next_valid() {
+                // the block kernels are not constexpr, so constant evaluation takes the plain scan
+                if constexpr (use_kernel) {
+                    if (!std::is_constant_evaluated()) {
+                        if (current_ != last_) {
+                            auto next = cursor_.seek(std::to_address(current_), std::to_address(last_), stats_.counted(pred_.get()));
+                            stats_.scan(static_cast<std::size_t>(next - std::to_address(current_)), next != std::to_address(last_));
+                            current_ = from_address(next);
+                        }
+                        return;
+                    }
+                }
+                std::size_t skipped = 0;
+                while (current_ != last_ && !test(*current_)) {
+                    ++current_;
+                    ++skipped;
+                }
+                stats_.scan(skipped, current_ != last_);
+            };
+            // Stops at first_ when there is no earlier match; decrementing begin() is still a precondition violation.
+            constexpr void find_prev_valid() {
+                std::size_t skipped = 0;
+                bool matched = false;
+                while (current_ != first_) {
+                    --current_;
+                    if (test(*current_)) {
+                        matched = true;
+                        break;
+                    }
+                    ++skipped;
+                }
+                stats_.scan(skipped, matched);
+                if constexpr (use_kernel) {
+                    if (!std::is_constant_evaluated()) {
+                        cursor_.restart_after(std::to_address(current_), std::to_address(last_));
+                    }
+                }
+            };
+
+            // Plain scans store every candidate and keep it by advancing n with the predicate
+            // result, so a batch is collected without a data-dependent branch.
+            template<class Store>
+            std::size_t gather(std::size_t size, Store store) {
+                if (size == 0 || current_ == last_) {
+                    return 0;
+                }
+                std::size_t n = 0;
+                if constexpr (use_kernel || !std::is_same_v<Stats, no_stats>) {
+                    for (; n < size && current_ != last_; ++n) {
+                        store(n, current_);
+                        ++(*this);
+                    }
+                } else {
+                    store(n++, current_);
                     ++current_;
+                    while (n < size && current_ != last_) {
+                        store(n, current_);
+                        n += static_cast<std::size_t>(static_cast<bool>(std::invoke(pred_.get(), *current_)));
+                        ++current_;
+                    }
+                    find_next_valid();
+                }
+                return n;
+            }
+
+            constexpr bool test(reference x) const {
+                stats_.call();
+                return std::invoke(pred_.get(), x);
+            }
+
+            template<class Address>
+            constexpr Iterator from_address(Address p) const {
+                return current_ + (p - std::to_address(current_));
+            }
+
+            static constexpr auto make_first(const Iterator& first) {
+                if constexpr (is_bidirectional_v<Iterator>) {
+                    return first;
+                } else {
+                    return no_first{};
                 }
             };
 
             Iterator current_{};
-            Iterator last_{};
-            Predicate& pred_;
+            Sentinel last_{};
+            // only bidirectional iterators need the start of the range
+            [[no_unique_address]] std::conditional_t<is_bidirectional_v<Iterator>, Iterator, no_first> first_{};
+            [[no_unique_address]] pred_handle<Predicate> pred_{};
+            // match bitmask state for compare predicates over contiguous arithmetic data
+            [[no_unique_address]] typename simd::kernel_traits<Iterator, Predicate>::cursor cursor_{};
+            [[no_unique_address]] stats_handle<Stats> stats_{};
+        };
+
+        // Iterator of a filter_range over a single-pass source such as std::istream_iterator.
+        // The source iterator stays in the range and is only advanced in place, never copied,
+        // so every element is read once; all iterators of the range share that position.
+        template<class Iterator, class Predicate, class Sentinel = Iterator, class Stats = no_stats>
+        class input_filter_iterator {
+        public:
+            using value_type        = typename std::iterator_traits<Iterator>::value_type;
+            using reference         = typename std::iterator_traits<Iterator>::reference;
+            using pointer           = typename std::iterator_traits<Iterator>::pointer;
+            using difference_type   = std::ptrdiff_t;
+            using iterator_category = std::input_iterator_tag;
+            using iterator_concept  = std::input_iterator_tag;
+
+            // the end iterator of a common range
+            input_filter_iterator() = default;
+            constexpr input_filter_iterator(Iterator& current, const Sentinel& last, Predicate& pred, stats_handle<Stats> stats = {})
+                : current_(&current), last_(&last), pred_(pred), stats_(stats) {
+                find_next_valid();
+            }
+            // current must already be a match (or last)
+            constexpr input_filter_iterator(Iterator& current, const Sentinel& last, Predicate& pred, no_scan_t, stats_handle<Stats> stats = {})
+                : current_(&current), last_(&last), pred_(pred), stats_(stats) {}
+
+            constexpr reference operator*() const {return **current_;}
+            constexpr pointer operator->() const {return std::addressof(**current_);}
+
+            constexpr input_filter_iterator& operator++() {
+                if (!at_end()) {
+                    ++*current_;
+                    find_next_valid();
+                }
+                return *this;
+            }
+            constexpr void operator++(int) {++*this;}
+
+            constexpr decltype(auto) pred() const noexcept {return pred_.get();}
+
+            constexpr bool operator==(const input_filter_iterator& other) const {return at_end() == other.at_end();}
+            constexpr bool operator!=(const input_filter_iterator& other) const {return !(*this == other);}
+            friend constexpr bool operator==(const input_filter_iterator& it, const filter_sentinel<Sentinel>&) {return it.at_end();}
+
+        private:
+            constexpr bool at_end() const {return current_ == nullptr || *current_ == *last_;}
+
+            constexpr void find_next_valid() {
+                std::size_t skipped = 0;
+                while (*current_ != *last_ && !test(**current_)) {
+                    ++*current_;
+                    ++skipped;
+                }
+                stats_.scan(skipped, *current_ != *last_);
+            }
+
+            constexpr bool test(reference x) const {
+                stats_.call();
+                return std::invoke(pred_.get(), x);
+            }
+
+            Iterator* current_ = nullptr;
+            const Sentinel* last_ = nullptr;
+            [[no_unique_address]] pred_handle<Predicate> pred_{};
+            [[no_unique_address]] stats_handle<Stats> stats_{};
         };
     }
 
-    template<Impl::ValidIter Iterator>
-    class filter_range {
+    template<Impl::ValidIter Iterator, std::indirect_unary_predicate<Iterator> Pred, std::sentinel_for<Iterator> Sentinel = Iterator, class Stats = no_stats>
+    class filter_range : public std::ranges::view_interface<filter_range<Iterator, Pred, Sentinel, Stats>> {
     public:
-        using Predicate = std::function<bool(const typename std::iterator_traits<Iterator>::value_type&)>;
-        using iterator = Impl::filter_iterator<Iterator,Predicate>;
+        using Predicate = Pred;
+        using stats_type = Stats;
+        // Input iterators are filtered in a single pass: see Impl::input_filter_iterator.
+        using iterator = std::conditional_t<Impl::is_forward_v<Iterator>, Impl::filter_iterator<Iterator,Predicate,Sentinel,Stats>,
+            Impl::input_filter_iterator<Iterator,Predicate,Sentinel,Stats>>;
+        // end() of a common range is an iterator so that pre-C++20 algorithms keep working;
+        // otherwise it only wraps the underlying sentinel.
+        using sentinel = std::conditional_t<std::is_same_v<Iterator, Sentinel>, iterator, Impl::filter_sentinel<Sentinel>>;
+        using reverse_iterator = Impl::filter_iterator<std::reverse_iterator<Iterator>,Predicate,std::reverse_iterator<Iterator>,Stats>;
+
+        constexpr filter_range(Iterator first, Sentinel last, Predicate pred): first_(std::move(first)), last_{std::move(last)}, pred_(std::move(pred)) {};
+        // Records the scan statistics of all iterators of the range into stats, which must outlive them.
+        constexpr filter_range(Iterator first, Sentinel last, Predicate pred, Stats& stats) requires Impl::is_stats_sink_v<Stats>
+            : first_(std::move(first)), last_{std::move(last)}, pred_(std::move(pred)), stats_(stats) {}
+        // Filters by pred(std::invoke(proj, element)), e.g. filter_range(first, last, pred::greater(10), &CustomStruct::id).
+        template<class P, class Proj>
+            requires std::same_as<Predicate, pred::projected_t<P, Proj>>
+        constexpr filter_range(Iterator first, Sentinel last, P pred, Proj proj)
+            : filter_range(std::move(first), std::move(last), pred::project(std::move(pred), std::move(proj))) {}
+        // Filtering the iterators of another filter_range fuses both predicates into one
+        // pred::all_of, so the result still runs a single loop over the underlying range.
+        // The fused range keeps recording into the stats sink of the inner one.
+        template<class Inner, class End, class Outer>
+            requires std::same_as<Predicate, pred::all_of_result_t<const Inner&, Outer>>
+        constexpr filter_range(Impl::filter_iterator<Iterator, Inner, Sentinel, Stats> first, End last, Outer pred)
+            : filter_range(first.base(), last.base(), pred::all_of(first.pred(), std::move(pred)), first.stats()) {}
+        // Shares the stats sink of another range or iterator.
+        constexpr filter_range(Iterator first, Sentinel last, Predicate pred, Impl::stats_handle<Stats> stats)
+            : first_(std::move(first)), last_{std::move(last)}, pred_(std::move(pred)), stats_(stats) {}
+
+        // The first match is searched once and cached, like std::ranges::filter_view.
+        // The cache stays valid while no element before the cached match starts
+        // satisfying the predicate and the cached element keeps satisfying it;
+        // otherwise call invalidate() before the next begin().
+        // A single-pass range scans its source in place, so begin() only resumes where the
+        // previous iterator stopped.
+        constexpr iterator begin() {
+            if constexpr (!Impl::is_forward_v<Iterator>) {
+                if (!begin_cached_) {
+                    begin_cached_ = true;
+                    return iterator(first_,last_,pred_.get(),stats_);
+                }
+                return iterator(first_,last_,pred_.get(),Impl::no_scan,stats_);
+            } else {
+                if (!begin_cached_) {
+                    // the scanning iterator keeps the rest of its block mask, so it is returned as is
+                    iterator it(first_,first_,last_,pred_.get(),stats_);
+                    cached_begin_ = it.base();
+                    begin_cached_ = true;
+                    return it;
+                }
+                return iterator(first_,cached_begin_,last_,pred_.get(),Impl::no_scan,stats_);
+            }
+        };
+        constexpr sentinel end() noexcept(nothrow_handle) {
+            if constexpr (!Impl::is_forward_v<Iterator> && std::is_same_v<Iterator, Sentinel>) {
+                return iterator();
+            } else if constexpr (std::is_same_v<Iterator, Sentinel>) {
+                return iterator(first_,last_,last_,pred_.get(),Impl::no_scan,stats_);
+            } else {
+                return sentinel(last_);
+            }
+        };
 
-        filter_range(Iterator first, Iterator last, Predicate && pred): first_(first), last_{last}, pred_(std::move(pred)) {};
+        // Concurrent mode: with a shareable predicate (stateless, pred::per_iterator or
+        // pred::const_call) and no stats sink, a forward range can be iterated through a const
+        // reference from any number of threads at once. The const begin() uses the cached first
+        // match if there is one but never fills the cache; call begin() once on the non-const
+        // range to fill it before sharing. Non-const members must not run concurrently with it.
+        constexpr iterator begin() const requires Impl::is_forward_v<Iterator> && Impl::is_shareable_v<Predicate> && std::same_as<Stats, no_stats> {
+            if (begin_cached_) {
+                return iterator(first_,cached_begin_,last_,shared_pred(),Impl::no_scan,stats_);
+            }
+            return iterator(first_,first_,last_,shared_pred(),stats_);
+        }
+        constexpr sentinel end() const noexcept(nothrow_handle) requires Impl::is_forward_v<Iterator> && Impl::is_shareable_v<Predicate> && std::same_as<Stats, no_stats> {
+            if constexpr (std::is_same_v<Iterator, Sentinel>) {
+                return iterator(first_,last_,last_,shared_pred(),Impl::no_scan,stats_);
+            } else {
+                return sentinel(last_);
+            }
+        }
 
-        iterator begin() noexcept {
-            return Impl::filter_iterator(first_,last_,pred_);
+        // Scans backwards from last, so only the tail up to the requested matches is touched.
+        constexpr reverse_iterator rbegin() requires Impl::is_bidirectional_v<Iterator> && std::same_as<Iterator, Sentinel> {
+            return reverse_iterator(std::make_reverse_iterator(last_),std::make_reverse_iterator(last_),std::make_reverse_iterator(first_),pred_.get(),stats_);
         };
-        iterator end() noexcept {
-            return Impl::filter_iterator(last_,last_,pred_);
+        constexpr reverse_iterator rend() noexcept(nothrow_handle) requires Impl::is_bidirectional_v<Iterator> && std::same_as<Iterator, Sentinel> {
+            return reverse_iterator(std::make_reverse_iterator(last_),std::make_reverse_iterator(first_),std::make_reverse_iterator(first_),pred_.get(),Impl::no_scan,stats_);
         };
 
+        // Stops at the first match, which begin() caches.
+        constexpr bool empty() {
+            return begin() == end();
+        }
+
+        // Counts the matches once and caches the count together with begin(); contiguous
+        // ranges filtered by a pred::compare are counted a 64-element mask at a time.
+        constexpr std::size_t size() requires Impl::is_forward_v<Iterator> {
+            if (!size_cached_) {
+                cached_size_ = count();
+                size_cached_ = true;
+            }
+            return cached_size_;
+        }
+
+        // Positions of all matches relative to base_begin(), decoded from the 64-element match
+        // masks, so one filter result can be reused across passes or parallel columns without
+        // calling the predicate again. Also caches size(). Throws std::length_error if a position
+        // does not fit in Index.
+        template<class Index = std::uint32_t>
+            requires std::random_access_iterator<Iterator>
+        std::vector<Index> select_indices() {
+            static_assert(std::is_unsigned_v<Index>, "select_indices stores positions as unsigned integers");
+            constexpr auto max_position = static_cast<std::size_t>(std::numeric_limits<Index>::max());
+            std::vector<Index> positions;
+            if (size_cached_) {
+                positions.reserve(cached_size_);
+            }
+            if constexpr (simd::is_kernel_v<Iterator, Predicate> && std::is_same_v<Iterator, Sentinel>) {
+                if (first_ != last_ && static_cast<std::size_t>(last_ - first_) - 1 > max_position) {
+                    throw std::length_error("filter_range::select_indices: positions do not fit the index type");
+                }
+                typename simd::kernel_traits<Iterator, Predicate>::cursor cursor(pred_.get());
+                cursor.select(std::to_address(first_), std::to_address(last_), stats_.counted(pred_.get()), positions);
+                record_scan(positions, static_cast<std::size_t>(last_ - first_));
+            } else {
+                std::size_t base = 0;
+                for (auto it = first_; it != last_;) {
+                    std::uint64_t mask = 0;
+                    std::size_t n = 0;
+                    for (; n < simd::block_size && it != last_; ++n, ++it) {
+                        stats_.call();
+                        mask |= static_cast<std::uint64_t>(static_cast<bool>(std::invoke(pred_.get(), *it))) << n;
+                    }
+                    if (base + n - 1 > max_position) {
+                        throw std::length_error("filter_range::select_indices: positions do not fit the index type");
+                    }
+                    simd::append_positions(mask, base, positions);
+                    base += n;
+                }
+                record_scan(positions, base);
+            }
+            cached_size_ = positions.size();
+            size_cached_ = true;
+            return positions;
+        }
+
+        // Copies the matches into a new sequence container built with alloc, e.g.
+        // to<std::pmr::vector<int>>(&resource), filling it in one pass. Containers with reserve()
+        // get capacity up front: an exact count when the block kernels apply or size() is cached,
+        // else an estimate from 256 evenly spaced elements of a random-access range, so the
+        // predicate must not depend on how often or in which order it is called.
+        template<class Container>
+            requires Impl::is_forward_v<Iterator>
+        Container to(const typename Container::allocator_type& alloc = typename Container::allocator_type()) {
+            Container out(alloc);
+            if constexpr (Impl::has_reserve_v<Container>) {
+                out.reserve(expected_size());
+            }
+            for (auto&& x : *this) {
+                out.push_back(std::forward<decltype(x)>(x));
+            }
+            return out;
+        }
+
+        // No effect on the begin() of a single-pass range, whose elements cannot be read again.
+        constexpr void invalidate() noexcept {
+            begin_cached_ = begin_cached_ && !Impl::is_forward_v<Iterator>;
+            size_cached_ = false;
+        }
+
+        constexpr const Iterator& base_begin() const noexcept {return first_;}
+        constexpr const Sentinel& base_end() const noexcept {return last_;}
+        constexpr const Predicate& pred() const noexcept {return pred_.get();}
+        constexpr Impl::stats_handle<Stats> stats() const noexcept {return stats_;}
+
     private:
+        // Capacity to reserve in to(): a little above the expected number of matches.
+        std::size_t expected_size() {
+            constexpr std::size_t sample = 256;
+            if constexpr (simd::is_kernel_v<Iterator, Predicate> && std::is_same_v<Iterator, Sentinel>) {
+                return size();
+            } else if constexpr (std::random_access_iterator<Iterator> && std::is_same_v<Iterator, Sentinel>) {
+                if (size_cached_) {
+                    return cached_size_;
+                }
+                const auto n = static_cast<std::size_t>(last_ - first_);
+                if (n <= sample) {
+                    return n;
+                }
+                std::size_t hits = 0;
+                for (std::size_t i = 0; i < sample; ++i) {
+                    stats_.call();
+                    hits += static_cast<std::size_t>(static_cast<bool>(std::invoke(pred_.get(), first_[static_cast<std::iter_difference_t<Iterator>>(i * n / sample)])));
+                }
+                // n / 16 is two standard errors of the sampled fraction at worst, so a vector rarely grows
+                const std::size_t estimate = hits * n / sample;
+                return std::min(n, estimate + estimate / 8 + n / 16);
+            } else {
+                return size_cached_ ? cached_size_ : 0;
+            }
+        }
+
+        // Records a scan of n elements with matches at positions as iterating over them would.
+        template<class Positions>
+        constexpr void record_scan(const Positions& positions, std::size_t n) const {
+            if constexpr (!std::is_same_v<Stats, no_stats>) {
+                std::size_t next = 0;
+                for (auto position : positions) {
+                    stats_.scan(static_cast<std::size_t>(position) - next, true);
+                    next = static_cast<std::size_t>(position) + 1;
+                }
+                stats_.scan(n - next, false);
+            }
+        }
+
+        // With a stats sink the whole range is scanned and recorded like in select_indices,
+        // so every full pass reports the same totals.
+        constexpr std::size_t count() {
+            if constexpr (simd::is_kernel_v<Iterator, Predicate> && std::is_same_v<Iterator, Sentinel>) {
+                if (!std::is_constant_evaluated()) {
+                    typename simd::kernel_traits<Iterator, Predicate>::cursor cursor(pred_.get());
+                    if constexpr (!std::is_same_v<Stats, no_stats>) {
+                        std::vector<std::size_t> positions;
+                        cursor.select(std::to_address(first_), std::to_address(last_), stats_.counted(pred_.get()), positions);
+                        record_scan(positions, static_cast<std::size_t>(last_ - first_));
+                        return positions.size();
+                    } else {
+                        return cursor.count(std::to_address(first_), std::to_address(last_), pred_.get());
+                    }
+                }
+            }
+            if constexpr (!std::is_same_v<Stats, no_stats>) {
+                std::size_t n = 0;
+                std::size_t skipped = 0;
+                for (auto it = first_; it != last_; ++it) {
+                    stats_.call();
+                    if (std::invoke(pred_.get(), *it)) {
+                        stats_.scan(skipped, true);
+                        skipped = 0;
+                        ++n;
+                    } else {
+                        ++skipped;
+                    }
+                }
+                stats_.scan(skipped, false);
+                return n;
+            }
+            // the match at begin() is known, so the predicate only runs on the elements after it
+            auto it = begin().base();
+            if (it == last_) {
+                return 0;
+            }
+            std::size_t n = 1;
+            for (++it; it != last_; ++it) {
+                n += static_cast<std::size_t>(static_cast<bool>(std::invoke(pred_.get(), *it)));
+            }
+            return n;
+        }
+
+        // false when iterators copy a predicate whose copy may throw (pred::per_iterator)
+        static constexpr bool nothrow_handle = std::is_nothrow_constructible_v<Impl::pred_handle<Predicate>, Predicate&>;
+
+        // The handles of shareable predicates never modify the range's predicate: they ignore
+        // it, copy it, or only call its const operator().
+        constexpr Predicate& shared_pred() const noexcept {return const_cast<Predicate&>(pred_.get());}
+
         Iterator first_{};
-        Iterator last_{};
-        Predicate pred_;
+        Sentinel last_{};
+        Impl::assignable_box<Predicate> pred_;
+        Iterator cached_begin_{};
+        std::size_t cached_size_ = 0;
+        bool begin_cached_ = false;
+        bool size_cached_ = false;
+        [[no_unique_address]] Impl::stats_handle<Stats> stats_{};
+    };
+
+    template<class Iterator, class Inner, class Sentinel, class InnerStats, class End, class Outer>
+    filter_range(Impl::filter_iterator<Iterator, Inner, Sentinel, InnerStats>, End, Outer) -> filter_range<Iterator, pred::all_of_result_t<const Inner&, Outer>, Sentinel, InnerStats>;
+
+    template<class Iterator, class Sentinel, class Pred, class Stats, typename = std::enable_if_t<Impl::is_stats_sink_v<Stats>>>
+    filter_range(Iterator, Sentinel, Pred, Stats&) -> filter_range<Iterator, Pred, Sentinel, Stats>;
+
+    template<class Iterator, class Sentinel, class Pred, class Proj, typename = std::enable_if_t<!Impl::is_stats_sink_v<std::remove_cvref_t<Proj>>>>
+    filter_range(Iterator, Sentinel, Pred, Proj&&) -> filter_range<Iterator, pred::projected_t<Pred, std::decay_t<Proj>>, Sentinel>;
+
+    namespace Impl {
+        template<class Range>
+        inline constexpr bool is_filter_range_v = false;
+        template<class Iterator, class Pred, class Sentinel, class Stats>
+        inline constexpr bool is_filter_range_v<filter_range<Iterator, Pred, Sentinel, Stats>> = true;
+    }
+
+    // Ends a range at the first element equal to value, e.g. value_sentinel<char>{'\0'} for
+    // null-terminated strings, so the end is found by the filtering pass itself.
+    template<class T>
+    struct value_sentinel {
+        T value{};
+
+        template<class Iterator>
+            requires std::indirectly_readable<Iterator> && std::equality_comparable_with<std::iter_reference_t<Iterator>, const T&>
+        friend constexpr bool operator==(const Iterator& it, const value_sentinel& last) {return *it == last.value;}
+    };
+
+    // Copies the matches of a C array, std::array or other range into a std::array<T, N>, also
+    // in constant expressions, e.g. to filter a static table at compile time:
+    //     constexpr auto n = iterator::filter_range(std::begin(ops), std::end(ops), pred).size();
+    //     constexpr auto reads = iterator::filter_to_array<n>(ops, pred);
+    // Throws std::length_error, a compile error in a constant expression, unless there are exactly N matches.
+    template<std::size_t N, class Range, class Pred>
+    constexpr auto filter_to_array(Range&& range, Pred pred) {
+        std::array<std::ranges::range_value_t<Range>, N> out{};
+        std::size_t n = 0;
+        for (auto&& x : filter_range(std::ranges::begin(range), std::ranges::end(range), std::move(pred))) {
+            if (n == N) {
+                throw std::length_error("filter_to_array: more than N matches");
+            }
+            out[n++] = std::forward<decltype(x)>(x);
+        }
+        if (n != N) {
+            throw std::length_error("filter_to_array: fewer than N matches");
+        }
+        return out;
+    }
+
+    namespace Impl {
+        // Optional whose copies start out empty, for state that points into the object holding it.
+        template<class T>
+        class non_propagating_cache {
+        public:
+            non_propagating_cache() = default;
+            constexpr non_propagating_cache(const non_propagating_cache&) noexcept {}
+            constexpr non_propagating_cache(non_propagating_cache&& other) noexcept {other.value_.reset();}
+            constexpr non_propagating_cache& operator=(const non_propagating_cache& other) noexcept {
+                if (this != &other) {
+                    value_.reset();
+                }
+                return *this;
+            }
+            constexpr non_propagating_cache& operator=(non_propagating_cache&& other) noexcept {
+                value_.reset();
+                other.value_.reset();
+                return *this;
+            }
+
+            template<class... Args>
+            constexpr T& emplace(Args&&... args) {return value_.emplace(std::forward<Args>(args)...);}
+            constexpr bool has_value() const noexcept {return value_.has_value();}
+            constexpr T& operator*() noexcept {return *value_;}
+
+        private:
+            std::optional<T> value_;
+        };
+    }
+
+    // filter_range over a view it owns, which views::filter returns for temporaries that are not
+    // borrowed, e.g. v | std::views::transform(f) | iterator::views::filter(pred). The
+    // filter_range over the view's iterators is built by the first begin() or end() and again
+    // after every copy or move, since those iterators may point into the view.
+    template<class View, class Pred>
+    class filter_view : public std::ranges::view_interface<filter_view<View, Pred>> {
+    public:
+        using range_type = filter_range<std::ranges::iterator_t<View>, Pred, std::ranges::sentinel_t<View>>;
+
+        constexpr filter_view(View base, Pred pred): base_(std::move(base)), pred_(std::move(pred)) {}
+
+        constexpr auto begin() {return range().begin();}
+        constexpr auto end() {return range().end();}
+
+        constexpr const View& base() const& noexcept {return base_;}
+        constexpr View base() && {return std::move(base_);}
+        constexpr const Pred& pred() const noexcept {return pred_.get();}
+
+    private:
+        constexpr range_type& range() {
+            if (!range_.has_value()) {
+                range_.emplace(std::ranges::begin(base_), std::ranges::end(base_), pred_.get());
+            }
+            return *range_;
+        }
+
+        View base_;
+        Impl::assignable_box<Pred> pred_;
+        Impl::non_propagating_cache<range_type> range_;
     };
+
+    namespace views {
+        template<class Pred>
+        struct filter_closure;
+
+        struct filter_fn {
+            // The result refers to the elements of an lvalue or borrowed range, which must outlive it;
+            // other temporaries, such as a std::views::transform, are moved into a filter_view.
+            // A filter_range is not wrapped but fused: the result filters its underlying range with
+            // pred::all_of of both predicates, and keeps no reference to the filter_range itself.
+            template<class Range, class Pred>
+            constexpr auto operator()(Range&& range, Pred pred) const {
+                if constexpr (Impl::is_filter_range_v<std::remove_cvref_t<Range>>) {
+                    using R = std::remove_cvref_t<Range>;
+                    return filter_range<std::remove_cvref_t<decltype(range.base_begin())>, pred::all_of_result_t<const typename R::Predicate&, Pred>,
+                        std::remove_cvref_t<decltype(range.base_end())>, typename R::stats_type>(range.base_begin(), range.base_end(),
+                        pred::all_of(range.pred(), std::move(pred)), range.stats());
+                } else if constexpr (std::is_lvalue_reference_v<Range> || std::ranges::borrowed_range<Range>) {
+                    return filter_range(std::ranges::begin(range), std::ranges::end(range), std::move(pred));
+                } else {
+                    return filter_view<std::views::all_t<Range>, Pred>(std::views::all(std::forward<Range>(range)), std::move(pred));
+                }
+            }
+
+            template<class Pred>
+            constexpr filter_closure<Pred> operator()(Pred pred) const {
+                return filter_closure<Pred>{std::move(pred)};
+            }
+        };
+
+        template<class Pred>
+        struct filter_closure {
+            Pred pred;
+
+            template<class Range>
+                requires std::ranges::range<Range>
+                friend constexpr auto operator|(Range&& range, const filter_closure& closure) {
+                return filter_fn{}(std::forward<Range>(range), closure.pred);
+            }
+        };
+
+        // data | iterator::views::filter(pred) | std::views::take(n)
+        inline constexpr filter_fn filter{};
+    }
 }
 
+template<class Iterator, class Pred, class Sentinel, class Stats>
+inline constexpr bool std::ranges::enable_borrowed_range<::iterator::filter_range<Iterator, Pred, Sentinel, Stats>> = ::iterator::Impl::is_forward_v<Iterator> && ::iterator::Impl::is_stateless_v<Pred>;
+
 #endif //FILTERITERATOR_HPP
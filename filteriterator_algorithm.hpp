@@ -0,0 +1,213 @@
+#ifndef FILTERITERATOR_ALGORITHM_HPP
+#define FILTERITERATOR_ALGORITHM_HPP
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <functional>
+#include <iterator>
+#include <memory>
+#include <stdexcept>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace iterator {
+    namespace Impl {
+        // also used by filteriterator_parallel.hpp
+        template<class Iterator>
+        inline constexpr bool is_random_access_v = std::is_base_of_v<std::random_access_iterator_tag, typename std::iterator_traits<Iterator>::iterator_category>;
+
+        template<class InIt, class OutIt>
+        inline constexpr bool is_branchless_copyable_v = is_random_access_v<OutIt>
+            && std::is_trivially_copyable_v<typename std::iterator_traits<InIt>::value_type>;
+
+        template<class InIt>
+        InIt advance_up_to(InIt it, InIt last, std::size_t n) {
+            if constexpr (is_random_access_v<InIt>) {
+                return it + static_cast<typename std::iterator_traits<InIt>::difference_type>(std::min(n, static_cast<std::size_t>(last - it)));
+            } else {
+                for (; it != last && n > 0; --n) {
+                    ++it;
+                }
+                return it;
+            }
+        }
+
+        // Writes every element and advances out only past the kept ones; returns the number of
+        // neighbours whose results differ, which is about the misprediction count of a branchy loop.
+        template<class InIt, class OutIt, class Pred>
+        std::size_t copy_branchless(InIt& first, InIt last, OutIt& out, Pred& pred) {
+            std::size_t flips = 0;
+            bool previous = false;
+            for (; first != last; ++first) {
+                const bool keep = static_cast<bool>(std::invoke(pred, *first));
+                *out = *first;
+                out += static_cast<typename std::iterator_traits<OutIt>::difference_type>(keep);
+                flips += static_cast<std::size_t>(keep != previous);
+                previous = keep;
+            }
+            return flips;
+        }
+
+        // copy_if that does not inline into a branchless loop on its own
+        template<class InIt, class OutIt, class Pred>
+        void copy_branchy(InIt& first, InIt last, OutIt& out, Pred& pred) {
+            for (; first != last; ++first) {
+                if (std::invoke(pred, *first)) {
+                    *out = *first;
+                    ++out;
+                }
+            }
+        }
+
+        // Outputs of partition_into, addressed by a bucket index known only at run time.
+        template<class... OutIts>
+        class bucket_outputs {
+        public:
+            static constexpr std::size_t size = sizeof...(OutIts);
+            static constexpr bool uniform = (std::is_same_v<OutIts, std::tuple_element_t<0, std::tuple<OutIts...>>> && ...);
+
+            explicit bucket_outputs(OutIts... outs): outs_{std::move(outs)...} {}
+
+            template<class T>
+            void write(std::size_t bucket, T&& value) {
+                visit(bucket, [&value](auto& out) {
+                    *out = std::forward<T>(value);
+                    ++out;
+                });
+            }
+            template<class T>
+            void write(std::size_t bucket, const T* first, std::size_t n) {
+                visit(bucket, [first, n](auto& out) {out = std::copy(first, first + n, out);});
+            }
+
+            std::tuple<OutIts...> release() {
+                if constexpr (uniform) {
+                    return std::apply([](auto&... outs) {return std::tuple<OutIts...>(std::move(outs)...);}, outs_);
+                } else {
+                    return std::move(outs_);
+                }
+            }
+
+        private:
+            template<class F>
+            void visit(std::size_t bucket, F&& f) {
+                if constexpr (uniform) {
+                    f(outs_[bucket]);
+                } else {
+                    visit(bucket, f, std::index_sequence_for<OutIts...>{});
+                }
+            }
+            template<class F, std::size_t... I>
+            void visit(std::size_t bucket, F& f, std::index_sequence<I...>) {
+                static_cast<void>(((bucket == I ? (f(std::get<I>(outs_)), true) : false) || ...));
+            }
+
+            std::conditional_t<uniform, std::array<std::tuple_element_t<0, std::tuple<OutIts...>>, size>, std::tuple<OutIts...>> outs_;
+        };
+
+        // bucket index returned by the classifier of partition_into, checked against the outputs
+        template<class Classifier, class T>
+        std::size_t classify(Classifier& classifier, T&& x, std::size_t buckets) {
+            const auto bucket = static_cast<std::size_t>(std::invoke(classifier, std::forward<T>(x)));
+            if (bucket >= buckets) {
+                throw std::out_of_range("partition_into: bucket index out of range");
+            }
+            return bucket;
+        }
+
+        // elements of T in one write-combining buffer of four cache lines
+        template<class T>
+        inline constexpr std::size_t combine_capacity = sizeof(T) >= 256 ? 1 : 256 / sizeof(T);
+    }
+
+    // Copies the elements of [first, last) that satisfy pred to out without a data-dependent
+    // branch: every element is written, and out only moves past those that are kept. Faster
+    // than copy_if when the predicate result is hard to predict (around 50% random matches).
+    // out must have room for last - first elements, not only for the matches.
+    template<class InIt, class OutIt, class Pred, typename = std::enable_if_t<Impl::is_branchless_copyable_v<InIt, OutIt>>>
+    OutIt filter_copy_branchless(InIt first, InIt last, OutIt out, Pred pred) {
+        Impl::copy_branchless(first, last, out, pred);
+        return out;
+    }
+
+    // Copies the elements of [first, last) that satisfy pred to out, choosing the loop per block
+    // of 4096 elements: the first 64 of a block are copied branchless while counting how often
+    // the predicate result changes, and the rest of the block continues branchless only if it
+    // changed often enough to defeat the branch predictor. Clustered or very selective data
+    // keeps the branchy loop. Same requirements on out as filter_copy_branchless.
+    template<class InIt, class OutIt, class Pred, typename = std::enable_if_t<Impl::is_branchless_copyable_v<InIt, OutIt>>>
+    OutIt filter_copy(InIt first, InIt last, OutIt out, Pred pred) {
+        constexpr std::size_t block = 4096;
+        constexpr std::size_t probe = 64;
+        // a flip in one neighbour pair out of 8 costs more in mispredictions than the extra stores
+        constexpr std::size_t max_flips = probe / 8;
+        while (first != last) {
+            auto probe_end = Impl::advance_up_to(first, last, probe);
+            auto block_end = Impl::advance_up_to(probe_end, last, block - probe);
+            if (Impl::copy_branchless(first, probe_end, out, pred) > max_flips) {
+                Impl::copy_branchless(first, block_end, out, pred);
+            } else {
+                Impl::copy_branchy(first, block_end, out, pred);
+            }
+        }
+        return out;
+    }
+
+    // Writes every element of [first, last) to outs[classifier(element)] in one pass, e.g. the
+    // matches and non-matches of several predicates without reading the data once per filter.
+    // classifier must return a bucket index below sizeof...(outs); any other index throws
+    // std::out_of_range, with the elements before it already written. Returns the end of every output.
+    template<class InIt, class Classifier, class... OutIts>
+    std::tuple<OutIts...> partition_into(InIt first, InIt last, Classifier classifier, OutIts... outs) {
+        static_assert(sizeof...(OutIts) > 0, "partition_into needs at least one output");
+        Impl::bucket_outputs<OutIts...> out(std::move(outs)...);
+        for (; first != last; ++first) {
+            out.write(Impl::classify(classifier, *first, sizeof...(OutIts)), *first);
+        }
+        return out.release();
+    }
+
+    // partition_into that gathers the elements of every bucket in a 256-byte write-combining
+    // buffer and writes them out a full buffer at a time, so each output is filled in sequential
+    // bursts instead of one element per stream in turn. It pays off when the outputs outnumber
+    // what the store buffers and TLB track at once; with up to 256 int buckets on a desktop
+    // core the direct partition_into is faster. If the classifier throws or returns an
+    // out-of-range index, the buffered elements are written before the exception propagates.
+    template<class InIt, class Classifier, class... OutIts>
+    std::tuple<OutIts...> partition_into_combined(InIt first, InIt last, Classifier classifier, OutIts... outs) {
+        using T = typename std::iterator_traits<InIt>::value_type;
+        static_assert(std::is_trivially_copyable_v<T>, "partition_into_combined buffers the elements as raw copies");
+        static_assert(sizeof...(OutIts) > 0, "partition_into needs at least one output");
+        constexpr std::size_t buckets = sizeof...(OutIts);
+        constexpr std::size_t capacity = Impl::combine_capacity<T>;
+        Impl::bucket_outputs<OutIts...> out(std::move(outs)...);
+        auto buffer = std::make_unique_for_overwrite<T[]>(buckets * capacity);
+        std::array<std::size_t, buckets> fill{};
+        auto flush = [&] {
+            for (std::size_t bucket = 0; bucket < buckets; ++bucket) {
+                out.write(bucket, static_cast<const T*>(buffer.get() + bucket * capacity), fill[bucket]);
+            }
+        };
+        try {
+            for (; first != last; ++first) {
+                const auto bucket = Impl::classify(classifier, *first, buckets);
+                T* line = buffer.get() + bucket * capacity;
+                line[fill[bucket]] = *first;
+                if (++fill[bucket] == capacity) {
+                    out.write(bucket, static_cast<const T*>(line), capacity);
+                    fill[bucket] = 0;
+                }
+            }
+        } catch (...) {
+            flush();
+            throw;
+        }
+        flush();
+        return out.release();
+    }
+}
+
+#endif //FILTERITERATOR_ALGORITHM_HPP
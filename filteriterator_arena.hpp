@@ -0,0 +1,109 @@
+#ifndef FILTERITERATOR_ARENA_HPP
+#define FILTERITERATOR_ARENA_HPP
+
+#include <algorithm>
+#include <cstddef>
+#include <limits>
+#include <memory>
+#include <memory_resource>
+#include <new>
+#include <vector>
+
+namespace iterator {
+    // Bump allocator for short-lived results such as the per-request output of
+    // filter_range::to: allocations are carved out of large blocks, deallocation does nothing,
+    // and reset() makes all blocks available again at once. Usable as a std::pmr memory
+    // resource or through arena_allocator. Not thread-safe.
+    class arena : public std::pmr::memory_resource {
+    public:
+        explicit arena(std::size_t block_size = 64 * 1024): block_size_(std::max<std::size_t>(block_size, 64)) {}
+        arena(const arena&) = delete;
+        arena& operator=(const arena&) = delete;
+
+        // Invalidates everything allocated so far; the blocks are kept for the next allocations.
+        void reset() noexcept {
+            current_ = 0;
+            offset_ = 0;
+            used_ = 0;
+        }
+
+        // bytes handed out since construction or the last reset()
+        std::size_t used() const noexcept {return used_;}
+        // bytes of all blocks, which stay allocated until destruction
+        std::size_t capacity() const noexcept {
+            std::size_t total = 0;
+            for (const auto& b : blocks_) {
+                total += b.size;
+            }
+            return total;
+        }
+
+    private:
+        struct block {
+            std::unique_ptr<std::byte[]> data;
+            std::size_t size;
+        };
+
+        void* do_allocate(std::size_t bytes, std::size_t alignment) override {
+            for (; current_ < blocks_.size(); ++current_, offset_ = 0) {
+                if (void* p = carve(blocks_[current_], bytes, alignment)) {
+                    return p;
+                }
+            }
+            const std::size_t size = std::max(block_size_, bytes + alignment);
+            blocks_.push_back({std::make_unique_for_overwrite<std::byte[]>(size), size});
+            offset_ = 0;
+            return carve(blocks_.back(), bytes, alignment);
+        }
+
+        void do_deallocate(void*, std::size_t, std::size_t) noexcept override {}
+
+        bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override {return this == &other;}
+
+        void* carve(block& b, std::size_t bytes, std::size_t alignment) noexcept {
+            void* p = b.data.get() + offset_;
+            std::size_t space = b.size - offset_;
+            if (std::align(alignment, bytes, p, space) == nullptr) {
+                return nullptr;
+            }
+            offset_ = b.size - space + bytes;
+            used_ += bytes;
+            return p;
+        }
+
+        std::size_t block_size_;
+        std::vector<block> blocks_;
+        std::size_t current_ = 0;
+        std::size_t offset_ = 0;
+        std::size_t used_ = 0;
+    };
+
+    // Allocator over an arena for containers without pmr support; copies share the arena.
+    template<class T>
+    class arena_allocator {
+    public:
+        using value_type = T;
+
+        explicit arena_allocator(arena& a) noexcept: arena_(&a) {}
+        template<class U>
+        arena_allocator(const arena_allocator<U>& other) noexcept: arena_(other.resource()) {}
+
+        T* allocate(std::size_t n) {
+            if (n > std::numeric_limits<std::size_t>::max() / sizeof(T)) {
+                throw std::bad_array_new_length();
+            }
+            return static_cast<T*>(arena_->allocate(n * sizeof(T), alignof(T)));
+        }
+        void deallocate(T*, std::size_t) noexcept {}
+
+        arena* resource() const noexcept {return arena_;}
+
+        template<class U>
+        bool operator==(const arena_allocator<U>& other) const noexcept {return arena_ == other.resource();}
+
+    private:
+        arena* arena_;
+    };
+}
+
+#endif //FILTERITERATOR_ARENA_HPP
@@ -0,0 +1,169 @@
+#ifndef FILTERITERATOR_DSL_HPP
+#define FILTERITERATOR_DSL_HPP
+
+#include <functional>
+#include <type_traits>
+#include <utility>
+
+#include "filteriterator_simd.hpp"
+
+namespace iterator {
+    namespace dsl {
+        // Operand of a predicate expression computed from the element: the element itself (_1),
+        // a data member of it (field) or arithmetic on those, e.g. _1 % 3 or field(&S::id) * 2.
+        template<class Proj>
+        struct term {
+            [[no_unique_address]] Proj proj;
+
+            template<class T>
+            constexpr decltype(auto) operator()(T&& x) const {return std::invoke(proj, std::forward<T>(x));}
+        };
+
+        inline constexpr term<std::identity> _1{};
+
+        template<class T, class Element>
+        constexpr term<T Element::*> field(T Element::* member) {return {member};}
+
+        namespace Impl {
+            template<class T>
+            inline constexpr bool is_term_v = false;
+            template<class Proj>
+            inline constexpr bool is_term_v<term<Proj>> = true;
+
+            template<class T>
+            inline constexpr bool is_constant_v = std::is_arithmetic_v<T>;
+
+            template<class Operand, class T>
+            constexpr decltype(auto) evaluate(const Operand& operand, T& x) {
+                if constexpr (is_term_v<Operand>) {
+                    return operand(x);
+                } else {
+                    return operand;
+                }
+            }
+
+            // Op applied to two operands, each a term or a constant
+            template<class Op, class L, class R>
+            struct arithmetic {
+                [[no_unique_address]] L lhs;
+                [[no_unique_address]] R rhs;
+
+                template<class T>
+                constexpr auto operator()(T&& x) const {return Op{}(evaluate(lhs, x), evaluate(rhs, x));}
+            };
+
+            template<class Op, class L, class R>
+            constexpr term<arithmetic<Op, L, R>> make_arithmetic(L lhs, R rhs) {return {{lhs, rhs}};}
+
+            // comparison of two terms, e.g. field(&S::min) < field(&S::max); always a plain call
+            template<pred::cmp Op, class L, class R>
+            struct relation {
+                [[no_unique_address]] L lhs;
+                [[no_unique_address]] R rhs;
+
+                template<class T>
+                constexpr bool operator()(T&& x) const {return pred::Impl::apply<Op>(lhs(x), rhs(x));}
+            };
+
+            constexpr pred::cmp mirrored(pred::cmp op) {
+                switch (op) {
+                    case pred::cmp::lt: return pred::cmp::gt;
+                    case pred::cmp::le: return pred::cmp::ge;
+                    case pred::cmp::gt: return pred::cmp::lt;
+                    case pred::cmp::ge: return pred::cmp::le;
+                    default: return op;
+                }
+            }
+
+            // term Op value becomes the predicate types the engine already matches: a compare of
+            // the element or of a data member picks the block kernel of its type, anything
+            // else is a projected compare evaluated by a plain call.
+            template<pred::cmp Op, class Proj, class V>
+            constexpr auto compare_term(const term<Proj>& t, V value) {
+                if constexpr (std::is_same_v<Proj, std::identity>) {
+                    return pred::compare<Op, V>{value};
+                } else {
+                    return pred::project(pred::compare<Op, V>{value}, t.proj);
+                }
+            }
+
+            template<pred::cmp Op, class L, class R>
+            constexpr auto make_compare(const L& lhs, const R& rhs) {
+                if constexpr (is_term_v<L> && is_term_v<R>) {
+                    return relation<Op, L, R>{lhs, rhs};
+                } else if constexpr (is_term_v<L>) {
+                    return compare_term<Op>(lhs, rhs);
+                } else {
+                    return compare_term<mirrored(Op)>(rhs, lhs);
+                }
+            }
+
+            // at least one side is a term, the other a term or an arithmetic constant
+            template<class L, class R>
+            inline constexpr bool is_operands_v = (is_term_v<L> && (is_term_v<R> || is_constant_v<R>)) || (is_constant_v<L> && is_term_v<R>);
+        }
+
+        template<class L, class R, std::enable_if_t<Impl::is_operands_v<L, R>, int> = 0>
+        constexpr auto operator==(const L& lhs, const R& rhs) {return Impl::make_compare<pred::cmp::eq>(lhs, rhs);}
+        template<class L, class R, std::enable_if_t<Impl::is_operands_v<L, R>, int> = 0>
+        constexpr auto operator!=(const L& lhs, const R& rhs) {return Impl::make_compare<pred::cmp::ne>(lhs, rhs);}
+        template<class L, class R, std::enable_if_t<Impl::is_operands_v<L, R>, int> = 0>
+        constexpr auto operator<(const L& lhs, const R& rhs) {return Impl::make_compare<pred::cmp::lt>(lhs, rhs);}
+        template<class L, class R, std::enable_if_t<Impl::is_operands_v<L, R>, int> = 0>
+        constexpr auto operator<=(const L& lhs, const R& rhs) {return Impl::make_compare<pred::cmp::le>(lhs, rhs);}
+        template<class L, class R, std::enable_if_t<Impl::is_operands_v<L, R>, int> = 0>
+        constexpr auto operator>(const L& lhs, const R& rhs) {return Impl::make_compare<pred::cmp::gt>(lhs, rhs);}
+        template<class L, class R, std::enable_if_t<Impl::is_operands_v<L, R>, int> = 0>
+        constexpr auto operator>=(const L& lhs, const R& rhs) {return Impl::make_compare<pred::cmp::ge>(lhs, rhs);}
+
+        template<class L, class R, std::enable_if_t<Impl::is_operands_v<L, R>, int> = 0>
+        constexpr auto operator+(const L& lhs, const R& rhs) {return Impl::make_arithmetic<std::plus<>>(lhs, rhs);}
+        template<class L, class R, std::enable_if_t<Impl::is_operands_v<L, R>, int> = 0>
+        constexpr auto operator-(const L& lhs, const R& rhs) {return Impl::make_arithmetic<std::minus<>>(lhs, rhs);}
+        template<class L, class R, std::enable_if_t<Impl::is_operands_v<L, R>, int> = 0>
+        constexpr auto operator*(const L& lhs, const R& rhs) {return Impl::make_arithmetic<std::multiplies<>>(lhs, rhs);}
+        template<class L, class R, std::enable_if_t<Impl::is_operands_v<L, R>, int> = 0>
+        constexpr auto operator/(const L& lhs, const R& rhs) {return Impl::make_arithmetic<std::divides<>>(lhs, rhs);}
+        template<class L, class R, std::enable_if_t<Impl::is_operands_v<L, R>, int> = 0>
+        constexpr auto operator%(const L& lhs, const R& rhs) {return Impl::make_arithmetic<std::modulus<>>(lhs, rhs);}
+        template<class L, class R, std::enable_if_t<Impl::is_operands_v<L, R>, int> = 0>
+        constexpr auto operator&(const L& lhs, const R& rhs) {return Impl::make_arithmetic<std::bit_and<>>(lhs, rhs);}
+    }
+
+    namespace pred {
+        namespace Impl {
+            // predicates that combine with &&, || and !
+            template<class T>
+            inline constexpr bool is_expression_v = is_compare_v<T>;
+            template<class... Preds>
+            inline constexpr bool is_expression_v<all_of_t<Preds...>> = true;
+            template<class... Preds>
+            inline constexpr bool is_expression_v<any_of_t<Preds...>> = true;
+            template<class Pred>
+            inline constexpr bool is_expression_v<not_t<Pred>> = true;
+            template<class Pred, class Proj>
+            inline constexpr bool is_expression_v<projected_t<Pred, Proj>> = true;
+            template<cmp Op, class L, class R>
+            inline constexpr bool is_expression_v<dsl::Impl::relation<Op, L, R>> = true;
+        }
+
+        // Build all_of, any_of and not_ from expressions, e.g. _1 > 500 && _1 < 900 is
+        // all_of(greater(500), less(900)) and is evaluated with one block kernel per compare.
+        // Both operands are always built; the result short-circuits when it is called.
+        template<class L, class R, std::enable_if_t<Impl::is_expression_v<std::decay_t<L>> && Impl::is_expression_v<std::decay_t<R>>, int> = 0>
+        constexpr auto operator&&(L&& lhs, R&& rhs) {return all_of(std::forward<L>(lhs), std::forward<R>(rhs));}
+        template<class L, class R, std::enable_if_t<Impl::is_expression_v<std::decay_t<L>> && Impl::is_expression_v<std::decay_t<R>>, int> = 0>
+        constexpr auto operator||(L&& lhs, R&& rhs) {return any_of(std::forward<L>(lhs), std::forward<R>(rhs));}
+        template<class Pred, std::enable_if_t<Impl::is_expression_v<std::decay_t<Pred>>, int> = 0>
+        constexpr auto operator!(Pred&& pred) {return not_(std::forward<Pred>(pred));}
+    }
+
+    namespace dsl {
+        // found by lookup for expressions built from relations, which live in this namespace
+        using pred::operator&&;
+        using pred::operator||;
+        using pred::operator!;
+    }
+}
+
+#endif //FILTERITERATOR_DSL_HPP
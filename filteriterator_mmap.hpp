@@ -0,0 +1,168 @@
+#ifndef FILTERITERATOR_MMAP_HPP
+#define FILTERITERATOR_MMAP_HPP
+
+#include <cerrno>
+#include <cstddef>
+#include <filesystem>
+#include <ranges>
+#include <system_error>
+#include <type_traits>
+#include <utility>
+
+#if defined(_WIN32)
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace iterator {
+    // Access pattern hints of mmap_record_range; the platform ignores those it has no call for.
+    struct mmap_hints {
+        // read-ahead aggressively and drop pages behind the scan (MADV_SEQUENTIAL, FILE_FLAG_SEQUENTIAL_SCAN)
+        bool sequential = true;
+        // start reading the whole file in the background right away (MADV_WILLNEED)
+        bool will_need = false;
+        // back the mapping with transparent huge pages where the file system supports it (MADV_HUGEPAGE)
+        bool huge_pages = false;
+    };
+
+    // Read-only memory mapping of a file of fixed-size records, exposed as a contiguous range
+    // of const T, e.g. iterator::filter_range(records.begin(), records.end(), pred). Nothing is
+    // copied: the filter reads the page cache directly, and compare predicates over arithmetic
+    // records take the SIMD kernels. Trailing bytes that do not fill a whole record are not
+    // part of the range. Throws std::system_error if the file cannot be opened or mapped.
+    template<class T>
+    class mmap_record_range : public std::ranges::view_interface<mmap_record_range<T>> {
+    public:
+        static_assert(std::is_trivially_copyable_v<T>, "mmap_record_range needs records that can be read from raw bytes");
+
+        mmap_record_range() = default;
+        explicit mmap_record_range(const std::filesystem::path& path, mmap_hints hints = {}) {
+            map(path, hints);
+        }
+        mmap_record_range(mmap_record_range&& other) noexcept
+            : data_(std::exchange(other.data_, nullptr)), size_(std::exchange(other.size_, 0)), bytes_(std::exchange(other.bytes_, 0)) {}
+        mmap_record_range& operator=(mmap_record_range&& other) noexcept {
+            if (this != &other) {
+                unmap();
+                data_ = std::exchange(other.data_, nullptr);
+                size_ = std::exchange(other.size_, 0);
+                bytes_ = std::exchange(other.bytes_, 0);
+            }
+            return *this;
+        }
+        mmap_record_range(const mmap_record_range&) = delete;
+        mmap_record_range& operator=(const mmap_record_range&) = delete;
+        ~mmap_record_range() {unmap();}
+
+        const T* begin() const noexcept {return data_;}
+        const T* end() const noexcept {return data_ + size_;}
+        const T* data() const noexcept {return data_;}
+        std::size_t size() const noexcept {return size_;}
+
+    private:
+#if defined(_WIN32)
+        void map(const std::filesystem::path& path, mmap_hints hints) {
+            HANDLE file = CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+                FILE_ATTRIBUTE_NORMAL | (hints.sequential ? FILE_FLAG_SEQUENTIAL_SCAN : 0), nullptr);
+            if (file == INVALID_HANDLE_VALUE) {
+                throw std::system_error(static_cast<int>(GetLastError()), std::system_category(), "mmap_record_range: open");
+            }
+            LARGE_INTEGER length{};
+            if (!GetFileSizeEx(file, &length)) {
+                auto error = GetLastError();
+                CloseHandle(file);
+                throw std::system_error(static_cast<int>(error), std::system_category(), "mmap_record_range: size");
+            }
+            bytes_ = static_cast<std::size_t>(length.QuadPart);
+            if (bytes_ < sizeof(T)) {
+                CloseHandle(file);
+                bytes_ = 0;
+                return;
+            }
+            HANDLE mapping = CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+            CloseHandle(file);
+            if (mapping == nullptr) {
+                throw std::system_error(static_cast<int>(GetLastError()), std::system_category(), "mmap_record_range: map");
+            }
+            void* view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+            auto error = GetLastError();
+            CloseHandle(mapping);
+            if (view == nullptr) {
+                throw std::system_error(static_cast<int>(error), std::system_category(), "mmap_record_range: map");
+            }
+            data_ = static_cast<const T*>(view);
+            size_ = bytes_ / sizeof(T);
+        }
+
+        void unmap() noexcept {
+            if (data_ != nullptr) {
+                UnmapViewOfFile(data_);
+                data_ = nullptr;
+            }
+        }
+#else
+        void map(const std::filesystem::path& path, mmap_hints hints) {
+            int fd = ::open(path.c_str(), O_RDONLY);
+            if (fd < 0) {
+                throw std::system_error(errno, std::generic_category(), "mmap_record_range: open");
+            }
+            struct stat info{};
+            if (::fstat(fd, &info) != 0) {
+                int error = errno;
+                ::close(fd);
+                throw std::system_error(error, std::generic_category(), "mmap_record_range: size");
+            }
+            bytes_ = static_cast<std::size_t>(info.st_size);
+            // mmap rejects empty mappings
+            if (bytes_ < sizeof(T)) {
+                ::close(fd);
+                bytes_ = 0;
+                return;
+            }
+            void* view = ::mmap(nullptr, bytes_, PROT_READ, MAP_PRIVATE, fd, 0);
+            int error = errno;
+            ::close(fd);
+            if (view == MAP_FAILED) {
+                throw std::system_error(error, std::generic_category(), "mmap_record_range: map");
+            }
+            // the hints only tune paging, so their failures are ignored
+            if (hints.sequential) {
+                ::madvise(view, bytes_, MADV_SEQUENTIAL);
+            }
+            if (hints.will_need) {
+                ::madvise(view, bytes_, MADV_WILLNEED);
+            }
+#if defined(MADV_HUGEPAGE)
+            if (hints.huge_pages) {
+                ::madvise(view, bytes_, MADV_HUGEPAGE);
+            }
+#endif
+            data_ = static_cast<const T*>(view);
+            size_ = bytes_ / sizeof(T);
+        }
+
+        void unmap() noexcept {
+            if (data_ != nullptr) {
+                ::munmap(const_cast<T*>(data_), bytes_);
+                data_ = nullptr;
+            }
+        }
+#endif
+
+        const T* data_ = nullptr;
+        std::size_t size_ = 0;
+        std::size_t bytes_ = 0;
+    };
+}
+
+#endif //FILTERITERATOR_MMAP_HPP
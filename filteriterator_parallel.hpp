@@ -0,0 +1,313 @@
+#ifndef FILTERITERATOR_PARALLEL_HPP
+#define FILTERITERATOR_PARALLEL_HPP
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <iterator>
+#include <memory>
+#include <mutex>
+#include <numeric>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "filteriterator_algorithm.hpp"
+
+namespace iterator {
+    namespace Impl {
+        // Runs fn(chunk) for chunk in [0, chunks), chunk 0 on the calling thread.
+        // The first exception thrown by any chunk is rethrown after all of them have finished.
+        template<class Fn>
+        void run_chunks(std::size_t chunks, Fn fn) {
+            std::vector<std::exception_ptr> errors(chunks);
+            std::vector<std::thread> workers;
+            workers.reserve(chunks > 0 ? chunks - 1 : 0);
+            auto guarded = [&fn, &errors](std::size_t chunk) {
+                try {
+                    fn(chunk);
+                } catch (...) {
+                    errors[chunk] = std::current_exception();
+                }
+            };
+            for (std::size_t chunk = 1; chunk < chunks; ++chunk) {
+                workers.emplace_back(guarded, chunk);
+            }
+            if (chunks > 0) {
+                guarded(0);
+            }
+            for (auto& worker : workers) {
+                worker.join();
+            }
+            for (auto& error : errors) {
+                if (error) {
+                    std::rethrow_exception(error);
+                }
+            }
+        }
+    }
+
+    // Copies the elements of [first, last) that satisfy pred to out, in their original order.
+    // Pass 1 counts the matches of every chunk in parallel, an exclusive prefix sum turns the
+    // counts into output offsets, and pass 2 copies every chunk straight to its offset.
+    // out must have room for all matches (at most last - first). Every thread works on its own
+    // copy of pred, which is called twice per element.
+    template<class RandomIt, class OutIt, class Pred, typename = std::enable_if_t<Impl::is_random_access_v<RandomIt> && Impl::is_random_access_v<OutIt>>>
+    OutIt parallel_filter_copy(RandomIt first, RandomIt last, OutIt out, Pred pred, unsigned threads = std::thread::hardware_concurrency()) {
+        using difference_type = typename std::iterator_traits<RandomIt>::difference_type;
+        const auto n = static_cast<std::size_t>(last - first);
+        std::size_t chunks = std::min<std::size_t>(std::max(threads, 1u), n);
+        if (chunks == 0) {
+            return out;
+        }
+        auto chunk_first = [&](std::size_t chunk) {
+            return first + static_cast<difference_type>(n * chunk / chunks);
+        };
+
+        std::vector<std::size_t> offsets(chunks + 1);
+        Impl::run_chunks(chunks, [&](std::size_t chunk) {
+            Pred local = pred;
+            std::size_t count = 0;
+            for (auto it = chunk_first(chunk), end = chunk_first(chunk + 1); it != end; ++it) {
+                if (std::invoke(local, *it)) {
+                    ++count;
+                }
+            }
+            offsets[chunk + 1] = count;
+        });
+        std::partial_sum(offsets.begin(), offsets.end(), offsets.begin());
+
+        Impl::run_chunks(chunks, [&](std::size_t chunk) {
+            Pred local = pred;
+            auto dest = out + static_cast<typename std::iterator_traits<OutIt>::difference_type>(offsets[chunk]);
+            for (auto it = chunk_first(chunk), end = chunk_first(chunk + 1); it != end; ++it) {
+                if (std::invoke(local, *it)) {
+                    *dest = *it;
+                    ++dest;
+                }
+            }
+        });
+        return out + static_cast<typename std::iterator_traits<OutIt>::difference_type>(offsets[chunks]);
+    }
+
+    // Fixed set of workers that split an index space [0, n) between them. Every worker owns
+    // a deque of index sub-ranges and takes grain-sized pieces from its front; a worker that
+    // runs dry steals the back half of another worker's largest remaining span, so clustered
+    // expensive work spreads over all workers. The calling thread acts as worker 0.
+    class work_stealing_pool {
+    public:
+        explicit work_stealing_pool(unsigned workers = std::thread::hardware_concurrency()): queues_(std::max(workers, 1u)) {
+            threads_.reserve(queues_.size() - 1);
+            for (unsigned id = 1; id < queues_.size(); ++id) {
+                threads_.emplace_back([this, id] { thread_main(id); });
+            }
+        }
+        work_stealing_pool(const work_stealing_pool&) = delete;
+        work_stealing_pool& operator=(const work_stealing_pool&) = delete;
+        ~work_stealing_pool() {
+            {
+                std::lock_guard lock(mutex_);
+                stop_ = true;
+            }
+            wake_.notify_all();
+            for (auto& thread : threads_) {
+                thread.join();
+            }
+        }
+
+        [[nodiscard]] unsigned size() const noexcept {return static_cast<unsigned>(queues_.size());}
+
+        // Calls body(worker, begin, end) for disjoint pieces of at most grain indices covering
+        // [0, n) and returns once all of them ran. The first exception thrown by body is
+        // rethrown here; pieces not yet started by then are skipped. Not reentrant.
+        template<class Body>
+        void run(std::size_t n, std::size_t grain, Body&& body) {
+            if (n == 0) {
+                return;
+            }
+            grain = std::max<std::size_t>(grain, 1);
+            const std::size_t workers = queues_.size();
+            for (std::size_t id = 0; id < workers; ++id) {
+                queues_[id].spans.clear();
+                std::size_t b = n * id / workers;
+                std::size_t e = n * (id + 1) / workers;
+                if (b != e) {
+                    queues_[id].spans.push_back({b, e});
+                }
+            }
+            {
+                std::lock_guard lock(mutex_);
+                job_ = [&body](unsigned worker, std::size_t b, std::size_t e) { body(worker, b, e); };
+                grain_ = grain;
+                remaining_.store(n);
+                error_ = nullptr;
+                failed_.store(false);
+                busy_ = threads_.size();
+                ++generation_;
+            }
+            wake_.notify_all();
+            work(0);
+            std::unique_lock lock(mutex_);
+            done_.wait(lock, [this] { return busy_ == 0; });
+            job_ = nullptr;
+            if (error_) {
+                std::rethrow_exception(std::exchange(error_, nullptr));
+            }
+        }
+
+    private:
+        struct span {
+            std::size_t begin;
+            std::size_t end;
+        };
+
+        struct queue {
+            std::mutex mutex;
+            std::deque<span> spans;
+        };
+
+        void thread_main(unsigned id) {
+            std::size_t seen = 0;
+            while (true) {
+                {
+                    std::unique_lock lock(mutex_);
+                    wake_.wait(lock, [&] { return stop_ || generation_ != seen; });
+                    if (stop_) {
+                        return;
+                    }
+                    seen = generation_;
+                }
+                work(id);
+                {
+                    std::lock_guard lock(mutex_);
+                    --busy_;
+                }
+                done_.notify_one();
+            }
+        }
+
+        void work(unsigned id) {
+            while (remaining_.load() != 0) {
+                span piece{};
+                if (pop(id, piece) || steal(id, piece)) {
+                    if (!failed_.load(std::memory_order_relaxed)) {
+                        try {
+                            job_(id, piece.begin, piece.end);
+                        } catch (...) {
+                            std::lock_guard lock(mutex_);
+                            if (!error_) {
+                                error_ = std::current_exception();
+                            }
+                            failed_.store(true, std::memory_order_relaxed);
+                        }
+                    }
+                    remaining_.fetch_sub(piece.end - piece.begin);
+                } else {
+                    std::this_thread::yield();
+                }
+            }
+        }
+
+        bool pop(unsigned id, span& piece) {
+            auto& own = queues_[id];
+            std::lock_guard lock(own.mutex);
+            if (own.spans.empty()) {
+                return false;
+            }
+            auto& front = own.spans.front();
+            piece = {front.begin, std::min(front.end, front.begin + grain_)};
+            front.begin = piece.end;
+            if (front.begin == front.end) {
+                own.spans.pop_front();
+            }
+            return true;
+        }
+
+        bool steal(unsigned id, span& piece) {
+            const auto workers = static_cast<unsigned>(queues_.size());
+            for (unsigned offset = 1; offset < workers; ++offset) {
+                auto& victim = queues_[(id + offset) % workers];
+                span stolen{};
+                {
+                    std::lock_guard lock(victim.mutex);
+                    if (victim.spans.empty()) {
+                        continue;
+                    }
+                    auto largest = std::max_element(victim.spans.begin(), victim.spans.end(), [](const span& a, const span& b) {
+                        return a.end - a.begin < b.end - b.begin;
+                    });
+                    std::size_t half = (largest->end - largest->begin) / 2;
+                    if (half == 0) {
+                        stolen = *largest;
+                        victim.spans.erase(largest);
+                    } else {
+                        stolen = {largest->end - half, largest->end};
+                        largest->end -= half;
+                    }
+                }
+                auto& own = queues_[id];
+                std::lock_guard lock(own.mutex);
+                own.spans.push_back(stolen);
+                piece = {stolen.begin, std::min(stolen.end, stolen.begin + grain_)};
+                own.spans.back().begin = piece.end;
+                if (own.spans.back().begin == own.spans.back().end) {
+                    own.spans.pop_back();
+                }
+                return true;
+            }
+            return false;
+        }
+
+        std::vector<queue> queues_;
+        std::vector<std::thread> threads_;
+        std::mutex mutex_;
+        std::condition_variable wake_;
+        std::condition_variable done_;
+        std::function<void(unsigned, std::size_t, std::size_t)> job_;
+        std::size_t grain_ = 1;
+        std::size_t generation_ = 0;
+        std::size_t busy_ = 0;
+        std::atomic<std::size_t> remaining_{0};
+        std::atomic<bool> failed_{false};
+        std::exception_ptr error_;
+        bool stop_ = false;
+    };
+
+    struct worker_stats {
+        std::size_t scanned = 0;
+        std::size_t matched = 0;
+    };
+
+    // Calls fn(element) for every match of a filter_range over a random-access base, with the
+    // scan spread over the pool. fn runs concurrently on distinct elements; every worker uses
+    // its own copy of the range's predicate. Returns how many elements each worker scanned and
+    // how many of them matched.
+    template<class Range, class Fn, typename = std::enable_if_t<Impl::is_random_access_v<std::decay_t<decltype(std::declval<Range&>().base_begin())>>>>
+    std::vector<worker_stats> parallel_for_each(Range& range, Fn fn, work_stealing_pool& pool, std::size_t grain = 1024) {
+        auto first = range.base_begin();
+        const auto n = static_cast<std::size_t>(range.base_end() - first);
+        using difference_type = typename std::iterator_traits<decltype(first)>::difference_type;
+        std::vector<worker_stats> stats(pool.size());
+        std::vector<std::decay_t<decltype(range.pred())>> preds(pool.size(), range.pred());
+        pool.run(n, grain, [&](unsigned worker, std::size_t b, std::size_t e) {
+            auto& pred = preds[worker];
+            std::size_t matched = 0;
+            for (auto it = first + static_cast<difference_type>(b), end = first + static_cast<difference_type>(e); it != end; ++it) {
+                if (std::invoke(pred, *it)) {
+                    ++matched;
+                    fn(*it);
+                }
+            }
+            stats[worker].scanned += e - b;
+            stats[worker].matched += matched;
+        });
+        return stats;
+    }
+}
+
+#endif //FILTERITERATOR_PARALLEL_HPP
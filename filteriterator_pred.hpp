@@ -0,0 +1,236 @@
+#ifndef FILTERITERATOR_PRED_HPP
+#define FILTERITERATOR_PRED_HPP
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <functional>
+#include <limits>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+namespace iterator {
+    namespace pred {
+        // Conjunction of its terms, evaluated left to right with short-circuiting. The terms are
+        // stored by value, so the whole expression is one predicate type that inlines into a
+        // single filter loop; a conjunction of stateless terms is stateless itself.
+        template<class... Preds>
+        struct all_of_t {
+            [[no_unique_address]] std::tuple<Preds...> preds;
+
+            template<class T>
+            constexpr bool operator()(T&& x) {
+                return std::apply([&x](auto&... p) {return (static_cast<bool>(std::invoke(p, x)) && ...);}, preds);
+            }
+            template<class T>
+            constexpr bool operator()(T&& x) const {
+                return std::apply([&x](const auto&... p) {return (static_cast<bool>(std::invoke(p, x)) && ...);}, preds);
+            }
+        };
+
+        // Disjunction of its terms, evaluated left to right with short-circuiting.
+        template<class... Preds>
+        struct any_of_t {
+            [[no_unique_address]] std::tuple<Preds...> preds;
+
+            template<class T>
+            constexpr bool operator()(T&& x) {
+                return std::apply([&x](auto&... p) {return (static_cast<bool>(std::invoke(p, x)) || ...);}, preds);
+            }
+            template<class T>
+            constexpr bool operator()(T&& x) const {
+                return std::apply([&x](const auto&... p) {return (static_cast<bool>(std::invoke(p, x)) || ...);}, preds);
+            }
+        };
+
+        template<class Pred>
+        struct not_t {
+            [[no_unique_address]] Pred pred;
+
+            template<class T>
+            constexpr bool operator()(T&& x) {return !static_cast<bool>(std::invoke(pred, x));}
+            template<class T>
+            constexpr bool operator()(T&& x) const {return !static_cast<bool>(std::invoke(pred, x));}
+        };
+
+        // Applies pred to std::invoke(proj, element), e.g. project(greater(10), &CustomStruct::id),
+        // so the predicate sees one field instead of the whole element. A compare projected
+        // onto an arithmetic data member is still evaluated with the block kernels.
+        template<class Pred, class Proj>
+        struct projected_t {
+            [[no_unique_address]] Pred pred;
+            [[no_unique_address]] Proj proj;
+
+            template<class T>
+            constexpr bool operator()(T&& x) {return static_cast<bool>(std::invoke(pred, std::invoke(proj, std::forward<T>(x))));}
+            template<class T>
+            constexpr bool operator()(T&& x) const {return static_cast<bool>(std::invoke(pred, std::invoke(proj, std::forward<T>(x))));}
+        };
+
+        namespace Impl {
+            template<template<class...> class Kind, class T>
+            inline constexpr bool is_kind_v = false;
+            template<template<class...> class Kind, class... Preds>
+            inline constexpr bool is_kind_v<Kind, Kind<Preds...>> = true;
+
+            // Terms of a nested all_of/any_of of the same kind are spliced into the outer one.
+            template<template<class...> class Kind, class Pred>
+            constexpr auto terms(Pred&& p) {
+                if constexpr (is_kind_v<Kind, std::decay_t<Pred>>) {
+                    return std::forward<Pred>(p).preds;
+                } else {
+                    return std::tuple<std::decay_t<Pred>>(std::forward<Pred>(p));
+                }
+            }
+
+            template<template<class...> class Kind, class... Preds>
+            constexpr auto make(std::tuple<Preds...>&& preds) {return Kind<Preds...>{std::move(preds)};}
+        }
+
+        template<class... Preds>
+        constexpr auto all_of(Preds&&... preds) {
+            return Impl::make<all_of_t>(std::tuple_cat(Impl::terms<all_of_t>(std::forward<Preds>(preds))...));
+        }
+
+        template<class... Preds>
+        constexpr auto any_of(Preds&&... preds) {
+            return Impl::make<any_of_t>(std::tuple_cat(Impl::terms<any_of_t>(std::forward<Preds>(preds))...));
+        }
+
+        template<class Pred>
+        constexpr not_t<std::decay_t<Pred>> not_(Pred&& pred) {return {std::forward<Pred>(pred)};}
+
+        template<class Pred, class Proj>
+        constexpr projected_t<std::decay_t<Pred>, std::decay_t<Proj>> project(Pred&& pred, Proj&& proj) {
+            return {std::forward<Pred>(pred), std::forward<Proj>(proj)};
+        }
+
+        // Every iterator of a filter_range over per_iterator(pred) owns a copy of pred, taken
+        // when the iterator is created, instead of pointing at the one in the range. Iterators
+        // on different threads therefore never call the same object, even for stateful
+        // predicates such as counters. The copies do not share their state.
+        template<class Pred>
+        struct per_iterator_t {
+            [[no_unique_address]] Pred pred;
+
+            template<class T>
+            constexpr bool operator()(T&& x) {return static_cast<bool>(std::invoke(pred, std::forward<T>(x)));}
+            template<class T>
+            constexpr bool operator()(T&& x) const {return static_cast<bool>(std::invoke(pred, std::forward<T>(x)));}
+        };
+
+        // Calls pred only through a const reference, so a filter_range over const_call(pred)
+        // does not compile unless pred is const-invocable. All iterators share the one object.
+        // A std::reference_wrapper is const-invocable whatever it refers to, so it is rejected.
+        template<class Pred>
+        struct const_call_t {
+            static_assert(!Impl::is_kind_v<std::reference_wrapper, Pred>, "const_call needs the predicate itself, not a reference to it");
+
+            [[no_unique_address]] Pred pred;
+
+            template<class T, typename = std::enable_if_t<std::is_invocable_v<const Pred&, T>>>
+            constexpr bool operator()(T&& x) const {return static_cast<bool>(std::invoke(pred, std::forward<T>(x)));}
+        };
+
+        template<class Pred>
+        constexpr per_iterator_t<std::decay_t<Pred>> per_iterator(Pred&& pred) {return {std::forward<Pred>(pred)};}
+
+        template<class Pred>
+        constexpr const_call_t<std::decay_t<Pred>> const_call(Pred&& pred) {return {std::forward<Pred>(pred)};}
+
+        // Conjunction whose terms are reordered while it runs. The first Period / 256 calls of
+        // every Period evaluate all terms and time each of them; at the end of the period the
+        // terms are sorted by measured cost per rejected element, so cheap terms that reject
+        // much run first and short-circuit the rest. Terms must be free of side effects, the
+        // result of the conjunction does not depend on the order.
+        template<std::size_t Period, class... Preds>
+        class adaptive_all_of_t {
+        public:
+            static_assert(Period >= 256, "adaptive_all_of needs at least 256 elements per period");
+            static constexpr std::size_t size = sizeof...(Preds);
+            static constexpr std::size_t sample = Period / 256;
+
+            explicit adaptive_all_of_t(Preds... preds): preds_(std::move(preds)...) {
+                for (std::size_t i = 0; i < size; ++i) {
+                    order_[i] = i;
+                }
+            }
+
+            template<class T>
+            bool operator()(T&& x) {
+                const std::size_t position = seen_++;
+                if (position < sample) {
+                    return measure(x);
+                }
+                bool result = true;
+                for (std::size_t i = 0; i < size && result; ++i) {
+                    result = call(order_[i], x, std::index_sequence_for<Preds...>{});
+                }
+                if (seen_ == Period) {
+                    rerank();
+                }
+                return result;
+            }
+
+            // order()[0] is the term evaluated first
+            const std::array<std::size_t, size>& order() const noexcept {return order_;}
+
+        private:
+            struct term_stats {
+                std::chrono::steady_clock::duration cost{};
+                std::size_t rejected = 0;
+            };
+
+            template<class T, std::size_t... I>
+            bool call(std::size_t term, T& x, std::index_sequence<I...>) {
+                bool result = false;
+                static_cast<void>(((term == I ? (result = static_cast<bool>(std::invoke(std::get<I>(preds_), x)), true) : false) || ...));
+                return result;
+            }
+
+            template<class T>
+            bool measure(T& x) {
+                bool result = true;
+                for (std::size_t term = 0; term < size; ++term) {
+                    auto start = std::chrono::steady_clock::now();
+                    bool passed = call(term, x, std::index_sequence_for<Preds...>{});
+                    stats_[term].cost += std::chrono::steady_clock::now() - start;
+                    if (!passed) {
+                        ++stats_[term].rejected;
+                        result = false;
+                    }
+                }
+                return result;
+            }
+
+            // expected cost of a term per element it removes; terms that never reject go last
+            void rerank() {
+                std::array<double, size> rank{};
+                for (std::size_t term = 0; term < size; ++term) {
+                    rank[term] = stats_[term].rejected == 0 ? std::numeric_limits<double>::infinity()
+                        : static_cast<double>(stats_[term].cost.count()) / static_cast<double>(stats_[term].rejected);
+                }
+                std::stable_sort(order_.begin(), order_.end(), [&rank](std::size_t a, std::size_t b) {return rank[a] < rank[b];});
+                stats_ = {};
+                seen_ = 0;
+            }
+
+            std::tuple<Preds...> preds_;
+            std::array<std::size_t, size> order_{};
+            std::array<term_stats, size> stats_{};
+            std::size_t seen_ = 0;
+        };
+
+        template<std::size_t Period = 16384, class... Preds>
+        adaptive_all_of_t<Period, std::decay_t<Preds>...> adaptive_all_of(Preds&&... preds) {
+            return adaptive_all_of_t<Period, std::decay_t<Preds>...>(std::forward<Preds>(preds)...);
+        }
+
+        template<class... Preds>
+        using all_of_result_t = decltype(all_of(std::declval<Preds>()...));
+    }
+}
+
+#endif //FILTERITERATOR_PRED_HPP
@@ -0,0 +1,160 @@
+#ifndef FILTERITERATOR_PREFETCH_HPP
+#define FILTERITERATOR_PREFETCH_HPP
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <iterator>
+#include <memory>
+#include <ranges>
+#include <type_traits>
+
+namespace iterator {
+    // Distance value that lets prefetch_iterator tune its look-ahead while it runs.
+    inline constexpr std::size_t prefetch_auto = 0;
+
+    namespace Impl {
+        template<class T>
+        inline void prefetch(const T* p) noexcept {
+#if defined(__GNUC__) || defined(__clang__)
+            __builtin_prefetch(p);
+#else
+            static_cast<void>(p);
+#endif
+        }
+    }
+
+    // Forward iterator over a node-based container (std::list, std::map, ...) that walks a
+    // second iterator distance elements ahead and prefetches the element under it, so the
+    // cache misses of the pointer chase overlap with the work done on the current element.
+    // With prefetch_auto the distance starts at 8 and is doubled or halved every 1024 steps,
+    // keeping the direction while the time per step improves.
+    template<class Iterator>
+    class prefetch_iterator {
+    public:
+        using value_type        = typename std::iterator_traits<Iterator>::value_type;
+        using reference         = typename std::iterator_traits<Iterator>::reference;
+        using pointer           = typename std::iterator_traits<Iterator>::pointer;
+        using difference_type   = typename std::iterator_traits<Iterator>::difference_type;
+        using iterator_category = std::forward_iterator_tag;
+        using iterator_concept  = std::forward_iterator_tag;
+
+        static constexpr std::size_t min_distance = 1;
+        static constexpr std::size_t max_distance = 64;
+        static constexpr std::size_t tune_period = 1024;
+
+        prefetch_iterator() = default;
+        prefetch_iterator(Iterator current, Iterator last, std::size_t distance = prefetch_auto)
+            : current_(current), ahead_(current), last_(last), tuning_(distance == prefetch_auto),
+              distance_(tuning_ ? 8 : std::clamp(distance, min_distance, max_distance)) {
+            reposition();
+            if (tuning_) {
+                period_start_ = std::chrono::steady_clock::now();
+            }
+        }
+
+        reference operator*() const {return *current_;}
+        pointer operator->() const {return &(*current_);}
+
+        prefetch_iterator& operator++() {
+            ++current_;
+            if (ahead_ != last_) {
+                ++ahead_;
+                if (ahead_ != last_) {
+                    Impl::prefetch(std::addressof(*ahead_));
+                }
+            }
+            if (tuning_ && ++steps_ == tune_period) {
+                tune();
+            }
+            return *this;
+        }
+        prefetch_iterator operator++(int) {
+            prefetch_iterator tmp = *this;
+            ++(*this);
+            return tmp;
+        }
+
+        const Iterator& base() const noexcept {return current_;}
+        std::size_t distance() const noexcept {return distance_;}
+
+        bool operator==(const prefetch_iterator& other) const {return current_ == other.current_;}
+        bool operator!=(const prefetch_iterator& other) const {return !(*this == other);}
+
+    private:
+        // puts ahead_ distance_ elements past current_, prefetching the elements in between
+        void reposition() {
+            ahead_ = current_;
+            for (std::size_t i = 0; i < distance_ && ahead_ != last_; ++i) {
+                ++ahead_;
+                if (ahead_ != last_) {
+                    Impl::prefetch(std::addressof(*ahead_));
+                }
+            }
+        }
+
+        void tune() {
+            auto now = std::chrono::steady_clock::now();
+            auto elapsed = now - period_start_;
+            period_start_ = now;
+            steps_ = 0;
+            if (previous_ != std::chrono::steady_clock::duration::zero() && elapsed > previous_) {
+                growing_ = !growing_;
+            }
+            previous_ = elapsed;
+            std::size_t next = growing_ ? std::min(distance_ * 2, max_distance) : std::max(distance_ / 2, min_distance);
+            if (next != distance_) {
+                distance_ = next;
+                reposition();
+            }
+        }
+
+        Iterator current_{};
+        Iterator ahead_{};
+        Iterator last_{};
+        bool tuning_ = false;
+        bool growing_ = true;
+        std::size_t distance_ = min_distance;
+        std::size_t steps_ = 0;
+        std::chrono::steady_clock::time_point period_start_{};
+        std::chrono::steady_clock::duration previous_{};
+    };
+
+    // [first, last) walked by prefetch_iterators, e.g. iterator::filter_range(r.begin(), r.end(), pred)
+    // or list | iterator::views::prefetch() | iterator::views::filter(pred).
+    template<class Iterator>
+    class prefetch_range : public std::ranges::view_interface<prefetch_range<Iterator>> {
+    public:
+        using iterator = prefetch_iterator<Iterator>;
+
+        prefetch_range() = default;
+        prefetch_range(Iterator first, Iterator last, std::size_t distance = prefetch_auto): first_(first), last_(last), distance_(distance) {}
+
+        iterator begin() const {return iterator(first_, last_, distance_);}
+        iterator end() const {return iterator(last_, last_, 1);}
+
+    private:
+        Iterator first_{};
+        Iterator last_{};
+        std::size_t distance_ = prefetch_auto;
+    };
+
+    namespace views {
+        struct prefetch_closure {
+            std::size_t distance;
+
+            // the range must outlive the result, like an lvalue passed to std::views::all
+            template<class Range, typename = std::enable_if_t<std::ranges::common_range<Range>>>
+            friend auto operator|(Range& range, const prefetch_closure& closure) {
+                return prefetch_range(std::ranges::begin(range), std::ranges::end(range), closure.distance);
+            }
+        };
+
+        inline prefetch_closure prefetch(std::size_t distance = prefetch_auto) {return {distance};}
+    }
+}
+
+template<class Iterator>
+inline constexpr bool std::ranges::enable_borrowed_range<::iterator::prefetch_range<Iterator>> = true;
+
+#endif //FILTERITERATOR_PREFETCH_HPP
@@ -0,0 +1,677 @@
+#ifndef FILTERITERATOR_SIMD_HPP
+#define FILTERITERATOR_SIMD_HPP
+
+#include <atomic>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <limits>
+#include <memory>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+#include "filteriterator_pred.hpp"
+
+#if (defined(__x86_64__) || defined(__i386__)) && (defined(__GNUC__) || defined(__clang__))
+#define FILTERITERATOR_X86_SIMD 1
+#include <immintrin.h>
+#define FILTERITERATOR_AVX2 __attribute__((target("avx2")))
+#endif
+
+namespace iterator {
+    namespace pred {
+        enum class cmp { eq, ne, lt, le, gt, ge };
+
+        namespace Impl {
+            template<class T>
+            constexpr auto as_standard_int(T x) {
+                using U = std::conditional_t<std::is_signed_v<T>, std::make_signed_t<T>, std::make_unsigned_t<T>>;
+                return static_cast<U>(x);
+            }
+
+            template<cmp Op, class T, class V>
+            constexpr bool apply_plain(const T& x, const V& v) {
+                if constexpr (Op == cmp::eq) return x == v;
+                else if constexpr (Op == cmp::ne) return x != v;
+                else if constexpr (Op == cmp::lt) return x < v;
+                else if constexpr (Op == cmp::le) return x <= v;
+                else if constexpr (Op == cmp::gt) return x > v;
+                else return x >= v;
+            }
+
+            // Integers are compared by value (std::cmp_*), so an unsigned element never wraps against a negative bound.
+            template<cmp Op, class T, class V>
+            constexpr bool apply(const T& x, const V& v) {
+                if constexpr (std::is_integral_v<T> && std::is_integral_v<V> && !std::is_same_v<T, bool> && !std::is_same_v<V, bool>) {
+                    auto a = as_standard_int(x);
+                    auto b = as_standard_int(v);
+                    if constexpr (Op == cmp::eq) return std::cmp_equal(a, b);
+                    else if constexpr (Op == cmp::ne) return std::cmp_not_equal(a, b);
+                    else if constexpr (Op == cmp::lt) return std::cmp_less(a, b);
+                    else if constexpr (Op == cmp::le) return std::cmp_less_equal(a, b);
+                    else if constexpr (Op == cmp::gt) return std::cmp_greater(a, b);
+                    else return std::cmp_greater_equal(a, b);
+                } else if constexpr (std::is_arithmetic_v<T> && std::is_arithmetic_v<V>) {
+                    // the usual arithmetic conversions, spelled out
+                    using C = std::common_type_t<T, V>;
+                    return apply_plain<Op>(static_cast<C>(x), static_cast<C>(v));
+                } else {
+                    return apply_plain<Op>(x, v);
+                }
+            }
+        }
+
+        // Comparison of the element against a constant. Unlike an equivalent lambda it is
+        // recognised by filter_iterator and evaluated with the block kernels below.
+        template<cmp Op, class V>
+        struct compare {
+            using value_type = V;
+            static constexpr cmp op = Op;
+
+            V value;
+
+            template<class T>
+            constexpr bool operator()(const T& x) const {return Impl::apply<Op>(x, value);}
+        };
+
+        template<class V> constexpr compare<cmp::eq, V> equal_to(V v) {return {v};}
+        template<class V> constexpr compare<cmp::ne, V> not_equal_to(V v) {return {v};}
+        template<class V> constexpr compare<cmp::lt, V> less(V v) {return {v};}
+        template<class V> constexpr compare<cmp::le, V> less_equal(V v) {return {v};}
+        template<class V> constexpr compare<cmp::gt, V> greater(V v) {return {v};}
+        template<class V> constexpr compare<cmp::ge, V> greater_equal(V v) {return {v};}
+
+        template<class P>
+        inline constexpr bool is_compare_v = false;
+        template<cmp Op, class V>
+        inline constexpr bool is_compare_v<compare<Op, V>> = true;
+    }
+
+    namespace simd {
+        enum class isa { scalar, sse2, avx2 };
+
+        // Every kernel evaluates exactly block_size elements into one bit per element.
+        inline constexpr std::size_t block_size = 64;
+
+        template<class T>
+        inline constexpr bool is_element_v = std::is_arithmetic_v<T> && !std::is_same_v<T, bool>
+            && (std::is_integral_v<T> ? (sizeof(T) == 1 || sizeof(T) == 2 || sizeof(T) == 4 || sizeof(T) == 8)
+                                      : (std::is_same_v<T, float> || std::is_same_v<T, double>));
+
+        inline isa detected_isa() noexcept {
+#if defined(FILTERITERATOR_X86_SIMD)
+            static const isa detected = [] {
+                __builtin_cpu_init();
+                if (__builtin_cpu_supports("avx2")) {
+                    return isa::avx2;
+                }
+                return __builtin_cpu_supports("sse2") ? isa::sse2 : isa::scalar;
+            }();
+            return detected;
+#else
+            return isa::scalar;
+#endif
+        }
+
+        namespace Impl {
+            inline std::atomic<isa>& max_isa() noexcept {
+                static std::atomic<isa> value{isa::avx2};
+                return value;
+            }
+        }
+
+        // Caps the instruction set used by the dispatcher, e.g. to compare paths in tests and benchmarks.
+        inline void set_max_isa(isa limit) noexcept {
+            Impl::max_isa().store(limit, std::memory_order_relaxed);
+        }
+
+        inline isa active_isa() noexcept {
+            isa limit = Impl::max_isa().load(std::memory_order_relaxed);
+            isa detected = detected_isa();
+            return static_cast<int>(limit) < static_cast<int>(detected) ? limit : detected;
+        }
+
+        // true when `value` converts to T without changing any comparison result of pred::compare.
+        // The range is checked before any cast, since converting an out-of-range floating-point
+        // value is undefined.
+        template<class T, class V>
+        constexpr bool representable(const V& value) {
+            if constexpr (std::is_same_v<V, bool> || !std::is_arithmetic_v<V>) {
+                return false;
+            } else if constexpr (std::is_integral_v<T> && std::is_integral_v<V>) {
+                return std::in_range<decltype(pred::Impl::as_standard_int(T{}))>(pred::Impl::as_standard_int(value));
+            } else if constexpr (std::is_floating_point_v<T> && std::is_integral_v<V>) {
+                // pred::compare converts the bound to T as well (T is the common type), so even
+                // an inexact bound such as LONG_MAX gives the same results
+                return true;
+            } else if constexpr (std::is_floating_point_v<T>) {
+                return value >= std::numeric_limits<T>::lowest() && value <= std::numeric_limits<T>::max()
+                    && static_cast<V>(static_cast<T>(value)) == value;
+            } else {
+                // Integral elements against a floating-point bound: pred::compare converts the
+                // element to V, which must hold every T exactly, and the bound must be a whole
+                // number in [min, max] of T. max + 1 is a power of two and exact in V.
+                if constexpr (std::numeric_limits<T>::digits > std::numeric_limits<V>::digits) {
+                    return false;
+                } else {
+                    constexpr V low = static_cast<V>(std::numeric_limits<T>::min());
+                    constexpr V high = static_cast<V>(std::numeric_limits<T>::max() / 2 + 1) * 2;
+                    return value >= low && value < high && static_cast<V>(static_cast<T>(value)) == value;
+                }
+            }
+        }
+
+        template<pred::cmp Op, class T>
+        std::uint64_t block_mask_scalar(const T* p, std::size_t n, T value) {
+            std::uint64_t mask = 0;
+            for (std::size_t i = 0; i < n; ++i) {
+                mask |= static_cast<std::uint64_t>(pred::Impl::apply<Op>(p[i], value)) << i;
+            }
+            return mask;
+        }
+
+#if defined(FILTERITERATOR_X86_SIMD)
+        namespace Impl {
+            // keeps every other bit, turning a byte mask of 16-bit lanes into one bit per lane
+            constexpr std::uint32_t compress_pairs(std::uint32_t m) {
+                m &= 0x55555555u;
+                m = (m | (m >> 1)) & 0x33333333u;
+                m = (m | (m >> 2)) & 0x0F0F0F0Fu;
+                m = (m | (m >> 4)) & 0x00FF00FFu;
+                m = (m | (m >> 8)) & 0x0000FFFFu;
+                return m;
+            }
+
+            template<class T>
+            __m128i sse2_set1(T v) {
+                if constexpr (sizeof(T) == 1) return _mm_set1_epi8(static_cast<char>(v));
+                else if constexpr (sizeof(T) == 2) return _mm_set1_epi16(static_cast<short>(v));
+                else return _mm_set1_epi32(static_cast<int>(v));
+            }
+
+            // unsigned lanes are compared as signed after flipping the sign bit
+            template<class T>
+            __m128i sse2_bias(__m128i x) {
+                if constexpr (std::is_unsigned_v<T>) {
+                    return _mm_xor_si128(x, sse2_set1<T>(static_cast<T>(T{1} << (sizeof(T) * 8 - 1))));
+                } else {
+                    return x;
+                }
+            }
+
+            template<class T>
+            __m128i sse2_cmpgt(__m128i a, __m128i b) {
+                if constexpr (sizeof(T) == 1) return _mm_cmpgt_epi8(a, b);
+                else if constexpr (sizeof(T) == 2) return _mm_cmpgt_epi16(a, b);
+                else return _mm_cmpgt_epi32(a, b);
+            }
+
+            template<class T>
+            __m128i sse2_cmpeq(__m128i a, __m128i b) {
+                if constexpr (sizeof(T) == 1) return _mm_cmpeq_epi8(a, b);
+                else if constexpr (sizeof(T) == 2) return _mm_cmpeq_epi16(a, b);
+                else return _mm_cmpeq_epi32(a, b);
+            }
+
+            template<pred::cmp Op, class T>
+            __m128i sse2_cmp(__m128i x, __m128i v) {
+                const __m128i ones = _mm_set1_epi32(-1);
+                if constexpr (Op == pred::cmp::eq) return sse2_cmpeq<T>(x, v);
+                else if constexpr (Op == pred::cmp::ne) return _mm_xor_si128(sse2_cmpeq<T>(x, v), ones);
+                else if constexpr (Op == pred::cmp::gt) return sse2_cmpgt<T>(x, v);
+                else if constexpr (Op == pred::cmp::lt) return sse2_cmpgt<T>(v, x);
+                else if constexpr (Op == pred::cmp::ge) return _mm_xor_si128(sse2_cmpgt<T>(v, x), ones);
+                else return _mm_xor_si128(sse2_cmpgt<T>(x, v), ones);
+            }
+
+            template<class T>
+            std::uint32_t sse2_bits(__m128i m) {
+                if constexpr (sizeof(T) == 1) return static_cast<std::uint32_t>(_mm_movemask_epi8(m));
+                else if constexpr (sizeof(T) == 2) return compress_pairs(static_cast<std::uint32_t>(_mm_movemask_epi8(m)));
+                else return static_cast<std::uint32_t>(_mm_movemask_ps(_mm_castsi128_ps(m)));
+            }
+
+            template<pred::cmp Op>
+            __m128 sse2_cmp_ps(__m128 x, __m128 v) {
+                if constexpr (Op == pred::cmp::eq) return _mm_cmpeq_ps(x, v);
+                else if constexpr (Op == pred::cmp::ne) return _mm_cmpneq_ps(x, v);
+                else if constexpr (Op == pred::cmp::gt) return _mm_cmpgt_ps(x, v);
+                else if constexpr (Op == pred::cmp::lt) return _mm_cmplt_ps(x, v);
+                else if constexpr (Op == pred::cmp::ge) return _mm_cmpge_ps(x, v);
+                else return _mm_cmple_ps(x, v);
+            }
+
+            template<pred::cmp Op>
+            __m128d sse2_cmp_pd(__m128d x, __m128d v) {
+                if constexpr (Op == pred::cmp::eq) return _mm_cmpeq_pd(x, v);
+                else if constexpr (Op == pred::cmp::ne) return _mm_cmpneq_pd(x, v);
+                else if constexpr (Op == pred::cmp::gt) return _mm_cmpgt_pd(x, v);
+                else if constexpr (Op == pred::cmp::lt) return _mm_cmplt_pd(x, v);
+                else if constexpr (Op == pred::cmp::ge) return _mm_cmpge_pd(x, v);
+                else return _mm_cmple_pd(x, v);
+            }
+
+            template<class T>
+            FILTERITERATOR_AVX2 __m256i avx2_set1(T v) {
+                if constexpr (sizeof(T) == 1) return _mm256_set1_epi8(static_cast<char>(v));
+                else if constexpr (sizeof(T) == 2) return _mm256_set1_epi16(static_cast<short>(v));
+                else if constexpr (sizeof(T) == 4) return _mm256_set1_epi32(static_cast<int>(v));
+                else return _mm256_set1_epi64x(static_cast<long long>(v));
+            }
+
+            template<class T>
+            FILTERITERATOR_AVX2 __m256i avx2_bias(__m256i x) {
+                if constexpr (std::is_unsigned_v<T>) {
+                    return _mm256_xor_si256(x, avx2_set1<T>(static_cast<T>(T{1} << (sizeof(T) * 8 - 1))));
+                } else {
+                    return x;
+                }
+            }
+
+            template<class T>
+            FILTERITERATOR_AVX2 __m256i avx2_cmpgt(__m256i a, __m256i b) {
+                if constexpr (sizeof(T) == 1) return _mm256_cmpgt_epi8(a, b);
+                else if constexpr (sizeof(T) == 2) return _mm256_cmpgt_epi16(a, b);
+                else if constexpr (sizeof(T) == 4) return _mm256_cmpgt_epi32(a, b);
+                else return _mm256_cmpgt_epi64(a, b);
+            }
+
+            template<class T>
+            FILTERITERATOR_AVX2 __m256i avx2_cmpeq(__m256i a, __m256i b) {
+                if constexpr (sizeof(T) == 1) return _mm256_cmpeq_epi8(a, b);
+                else if constexpr (sizeof(T) == 2) return _mm256_cmpeq_epi16(a, b);
+                else if constexpr (sizeof(T) == 4) return _mm256_cmpeq_epi32(a, b);
+                else return _mm256_cmpeq_epi64(a, b);
+            }
+
+            template<pred::cmp Op, class T>
+            FILTERITERATOR_AVX2 __m256i avx2_cmp(__m256i x, __m256i v) {
+                const __m256i ones = _mm256_set1_epi32(-1);
+                if constexpr (Op == pred::cmp::eq) return avx2_cmpeq<T>(x, v);
+                else if constexpr (Op == pred::cmp::ne) return _mm256_xor_si256(avx2_cmpeq<T>(x, v), ones);
+                else if constexpr (Op == pred::cmp::gt) return avx2_cmpgt<T>(x, v);
+                else if constexpr (Op == pred::cmp::lt) return avx2_cmpgt<T>(v, x);
+                else if constexpr (Op == pred::cmp::ge) return _mm256_xor_si256(avx2_cmpgt<T>(v, x), ones);
+                else return _mm256_xor_si256(avx2_cmpgt<T>(x, v), ones);
+            }
+
+            template<class T>
+            FILTERITERATOR_AVX2 std::uint32_t avx2_bits(__m256i m) {
+                if constexpr (sizeof(T) == 1) return static_cast<std::uint32_t>(_mm256_movemask_epi8(m));
+                else if constexpr (sizeof(T) == 2) return compress_pairs(static_cast<std::uint32_t>(_mm256_movemask_epi8(m)));
+                else if constexpr (sizeof(T) == 4) return static_cast<std::uint32_t>(_mm256_movemask_ps(_mm256_castsi256_ps(m)));
+                else return static_cast<std::uint32_t>(_mm256_movemask_pd(_mm256_castsi256_pd(m)));
+            }
+
+            template<pred::cmp Op>
+            constexpr int avx_predicate() {
+                if constexpr (Op == pred::cmp::eq) return _CMP_EQ_OQ;
+                else if constexpr (Op == pred::cmp::ne) return _CMP_NEQ_UQ;
+                else if constexpr (Op == pred::cmp::gt) return _CMP_GT_OQ;
+                else if constexpr (Op == pred::cmp::lt) return _CMP_LT_OQ;
+                else if constexpr (Op == pred::cmp::ge) return _CMP_GE_OQ;
+                else return _CMP_LE_OQ;
+            }
+        }
+
+        template<pred::cmp Op, class T>
+        std::uint64_t block_mask_sse2(const T* p, T value) {
+            std::uint64_t mask = 0;
+            if constexpr (std::is_same_v<T, float>) {
+                const __m128 v = _mm_set1_ps(value);
+                for (std::size_t i = 0; i < block_size; i += 4) {
+                    __m128 m = Impl::sse2_cmp_ps<Op>(_mm_loadu_ps(p + i), v);
+                    mask |= static_cast<std::uint64_t>(static_cast<unsigned>(_mm_movemask_ps(m))) << i;
+                }
+            } else if constexpr (std::is_same_v<T, double>) {
+                const __m128d v = _mm_set1_pd(value);
+                for (std::size_t i = 0; i < block_size; i += 2) {
+                    __m128d m = Impl::sse2_cmp_pd<Op>(_mm_loadu_pd(p + i), v);
+                    mask |= static_cast<std::uint64_t>(static_cast<unsigned>(_mm_movemask_pd(m))) << i;
+                }
+            } else if constexpr (sizeof(T) == 8) {
+                // SSE2 has no 64-bit integer compare
+                mask = block_mask_scalar<Op>(p, block_size, value);
+            } else {
+                const __m128i v = Impl::sse2_bias<T>(Impl::sse2_set1(value));
+                for (std::size_t i = 0; i < block_size; i += 16 / sizeof(T)) {
+                    __m128i x = Impl::sse2_bias<T>(_mm_loadu_si128(reinterpret_cast<const __m128i*>(p + i)));
+                    mask |= static_cast<std::uint64_t>(Impl::sse2_bits<T>(Impl::sse2_cmp<Op, T>(x, v))) << i;
+                }
+            }
+            return mask;
+        }
+
+        template<pred::cmp Op, class T>
+        FILTERITERATOR_AVX2 std::uint64_t block_mask_avx2(const T* p, T value) {
+            std::uint64_t mask = 0;
+            if constexpr (std::is_same_v<T, float>) {
+                const __m256 v = _mm256_set1_ps(value);
+                for (std::size_t i = 0; i < block_size; i += 8) {
+                    __m256 m = _mm256_cmp_ps(_mm256_loadu_ps(p + i), v, Impl::avx_predicate<Op>());
+                    mask |= static_cast<std::uint64_t>(static_cast<unsigned>(_mm256_movemask_ps(m))) << i;
+                }
+            } else if constexpr (std::is_same_v<T, double>) {
+                const __m256d v = _mm256_set1_pd(value);
+                for (std::size_t i = 0; i < block_size; i += 4) {
+                    __m256d m = _mm256_cmp_pd(_mm256_loadu_pd(p + i), v, Impl::avx_predicate<Op>());
+                    mask |= static_cast<std::uint64_t>(static_cast<unsigned>(_mm256_movemask_pd(m))) << i;
+                }
+            } else {
+                const __m256i v = Impl::avx2_bias<T>(Impl::avx2_set1(value));
+                for (std::size_t i = 0; i < block_size; i += 32 / sizeof(T)) {
+                    __m256i x = Impl::avx2_bias<T>(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(p + i)));
+                    mask |= static_cast<std::uint64_t>(Impl::avx2_bits<T>(Impl::avx2_cmp<Op, T>(x, v))) << i;
+                }
+            }
+            return mask;
+        }
+#endif
+
+        // Evaluates p[0, block_size) with the best instruction set allowed by active_isa().
+        template<pred::cmp Op, class T>
+        std::uint64_t block_mask(const T* p, T value, isa with = active_isa()) {
+#if defined(FILTERITERATOR_X86_SIMD)
+            switch (with) {
+                case isa::avx2:
+                    return block_mask_avx2<Op>(p, value);
+                case isa::sse2:
+                    return block_mask_sse2<Op>(p, value);
+                case isa::scalar:
+                    break;
+            }
+#else
+            (void)with;
+#endif
+            return block_mask_scalar<Op>(p, block_size, value);
+        }
+
+        // Appends base + the position of every set bit of mask to positions, lowest first: the
+        // output grows by popcount(mask) and each position costs one tzcnt, whatever the density.
+        template<class Positions>
+        void append_positions(std::uint64_t mask, std::size_t base, Positions& positions) {
+            using Index = typename Positions::value_type;
+            std::size_t n = positions.size();
+            positions.resize(n + static_cast<std::size_t>(std::popcount(mask)));
+            Index* out = positions.data() + n;
+            for (; mask != 0; mask &= mask - 1) {
+                *out++ = static_cast<Index>(base + static_cast<std::size_t>(std::countr_zero(mask)));
+            }
+        }
+
+        namespace Impl {
+            struct no_field {};
+
+            template<class T, class Element>
+            struct field_pointer {
+                using type = T Element::*;
+            };
+            template<class T>
+            struct field_pointer<T, T> {
+                using type = no_field;
+            };
+
+            // the compare of a plain compare predicate or of one projected onto a field
+            template<class Pred>
+            constexpr const auto& compare_of(const Pred& pred) {
+                if constexpr (pred::is_compare_v<Pred>) {
+                    return pred;
+                } else {
+                    return pred.pred;
+                }
+            }
+        }
+
+        // Mask of one full block for a compare predicate. With Element != T the predicate
+        // compares the field T Element::* of each element: the fields of a block are loaded at
+        // the element stride into a buffer, which the same kernels evaluate, so the rest of
+        // every element is never read. Disabled when the kernels cannot hold the value.
+        template<pred::cmp Op, class T, class Element = T>
+        class compare_block {
+        public:
+            compare_block() = default;
+            template<class Pred>
+            explicit constexpr compare_block(const Pred& pred)
+                : enabled_(representable<T>(Impl::compare_of(pred).value)), value_(enabled_ ? static_cast<T>(Impl::compare_of(pred).value) : T{}) {
+                if constexpr (!std::is_same_v<Element, T>) {
+                    field_ = pred.proj;
+                }
+            }
+
+            constexpr bool enabled() const noexcept {return enabled_;}
+
+            std::uint64_t operator()(const Element* p) const {
+                if constexpr (std::is_same_v<Element, T>) {
+                    return block_mask<Op>(p, value_);
+                } else {
+                    T fields[block_size];
+                    for (std::size_t i = 0; i < block_size; ++i) {
+                        fields[i] = p[i].*field_;
+                    }
+                    return block_mask<Op>(fields, value_);
+                }
+            }
+
+        private:
+            bool enabled_ = false;
+            T value_{};
+            [[no_unique_address]] typename Impl::field_pointer<T, Element>::type field_{};
+        };
+
+        // Mask of an all_of (All) or any_of of block predicates: the AND or OR of the masks of its terms.
+        template<bool All, class... Blocks>
+        class compound_block {
+        public:
+            compound_block() = default;
+            template<class Pred>
+            explicit constexpr compound_block(const Pred& pred): compound_block(pred, std::index_sequence_for<Blocks...>{}) {}
+
+            constexpr bool enabled() const noexcept {return enabled_;}
+
+            template<class Element>
+            std::uint64_t operator()(const Element* p) const {
+                return std::apply([p](const auto&... block) {
+                    if constexpr (All) {
+                        return (block(p) & ...);
+                    } else {
+                        return (block(p) | ...);
+                    }
+                }, blocks_);
+            }
+
+        private:
+            template<class Pred, std::size_t... I>
+            constexpr compound_block(const Pred& pred, std::index_sequence<I...>)
+                : blocks_(Blocks(std::get<I>(pred.preds))...), enabled_((std::get<I>(blocks_).enabled() && ...)) {}
+
+            std::tuple<Blocks...> blocks_{};
+            bool enabled_ = false;
+        };
+
+        // Mask of the predicate wrapped in pred.pred, inverted for not_.
+        template<class Block, bool Negate = false>
+        class inner_block {
+        public:
+            inner_block() = default;
+            template<class Pred>
+            explicit constexpr inner_block(const Pred& pred): block_(pred.pred) {}
+
+            constexpr bool enabled() const noexcept {return block_.enabled();}
+
+            template<class Element>
+            std::uint64_t operator()(const Element* p) const {
+                if constexpr (Negate) {
+                    return ~block_(p);
+                } else {
+                    return block_(p);
+                }
+            }
+
+        private:
+            Block block_{};
+        };
+
+        namespace Impl {
+            // The block predicate evaluating Pred over Elements, if there is one: compares of the
+            // element or of an arithmetic data member, all_of, any_of and not_ of those, and their
+            // per_iterator and const_call wrappers.
+            template<class Pred, class Element, class = void>
+            struct block_for {};
+
+            template<pred::cmp Op, class V, class Element>
+            struct block_for<pred::compare<Op, V>, Element, std::enable_if_t<is_element_v<Element>>> {
+                using type = compare_block<Op, Element>;
+            };
+
+            // e.g. pred::project(pred::greater(10), &CustomStruct::id)
+            template<pred::cmp Op, class V, class Element, class T>
+            struct block_for<pred::projected_t<pred::compare<Op, V>, T Element::*>, Element, std::enable_if_t<is_element_v<T> && !std::is_const_v<T>>> {
+                using type = compare_block<Op, T, Element>;
+            };
+
+            template<class... Preds, class Element>
+            struct block_for<pred::all_of_t<Preds...>, Element, std::enable_if_t<(sizeof...(Preds) > 0), std::void_t<typename block_for<Preds, Element>::type...>>> {
+                using type = compound_block<true, typename block_for<Preds, Element>::type...>;
+            };
+
+            template<class... Preds, class Element>
+            struct block_for<pred::any_of_t<Preds...>, Element, std::enable_if_t<(sizeof...(Preds) > 0), std::void_t<typename block_for<Preds, Element>::type...>>> {
+                using type = compound_block<false, typename block_for<Preds, Element>::type...>;
+            };
+
+            template<class Pred, class Element>
+            struct block_for<pred::not_t<Pred>, Element, std::void_t<typename block_for<Pred, Element>::type>> {
+                using type = inner_block<typename block_for<Pred, Element>::type, true>;
+            };
+
+            // per_iterator and const_call only change how iterators hold the predicate
+            template<class Pred, class Element>
+            struct block_for<pred::per_iterator_t<Pred>, Element, std::void_t<typename block_for<Pred, Element>::type>> {
+                using type = inner_block<typename block_for<Pred, Element>::type>;
+            };
+
+            template<class Pred, class Element>
+            struct block_for<pred::const_call_t<Pred>, Element, std::void_t<typename block_for<Pred, Element>::type>> {
+                using type = inner_block<typename block_for<Pred, Element>::type>;
+            };
+        }
+
+        // Walks the matches of a block predicate over contiguous memory one 64-element bitmask
+        // at a time; next() only touches memory when the current mask is exhausted. Tails
+        // shorter than a block, and blocks whose kernel is disabled, call the predicate.
+        template<class Block, class Element>
+        class mask_cursor {
+        public:
+            mask_cursor() = default;
+            template<class Pred>
+            explicit constexpr mask_cursor(const Pred& pred): kernel_(pred) {}
+
+            // first match in [p, last)
+            template<class Pred>
+            const Element* seek(const Element* p, const Element* last, const Pred& pred) {
+                scan_ = p;
+                mask_ = 0;
+                return next(last, pred);
+            }
+
+            // continue after p, which the caller has already visited
+            void restart_after(const Element* p, const Element* last) noexcept {
+                scan_ = p == last ? last : p + 1;
+                mask_ = 0;
+            }
+
+            template<class Pred>
+            const Element* next(const Element* last, const Pred& pred) {
+                while (mask_ == 0) {
+                    if (scan_ == last) {
+                        return last;
+                    }
+                    block_ = scan_;
+                    auto n = static_cast<std::size_t>(last - scan_);
+                    if (n >= block_size && kernel_.enabled()) {
+                        n = block_size;
+                        mask_ = kernel_(scan_);
+                    } else {
+                        n = n < block_size ? n : block_size;
+                        for (std::size_t i = 0; i < n; ++i) {
+                            mask_ |= static_cast<std::uint64_t>(static_cast<bool>(pred(scan_[i]))) << i;
+                        }
+                    }
+                    scan_ += n;
+                }
+                const Element* match = block_ + std::countr_zero(mask_);
+                mask_ &= mask_ - 1;
+                return match;
+            }
+
+            // Number of elements of [p, last) that satisfy pred: whole blocks are counted with one
+            // popcount of their mask, the tail and values the kernels cannot hold call pred.
+            template<class Pred>
+            std::size_t count(const Element* p, const Element* last, const Pred& pred) const {
+                std::size_t n = 0;
+                if (kernel_.enabled()) {
+                    for (; static_cast<std::size_t>(last - p) >= block_size; p += block_size) {
+                        n += static_cast<std::size_t>(std::popcount(kernel_(p)));
+                    }
+                }
+                for (; p != last; ++p) {
+                    n += static_cast<std::size_t>(static_cast<bool>(pred(*p)));
+                }
+                return n;
+            }
+
+            // Appends the positions of the matches in [p, last), relative to p, to positions.
+            template<class Pred, class Positions>
+            void select(const Element* p, const Element* last, const Pred& pred, Positions& positions) const {
+                const Element* first = p;
+                while (p != last) {
+                    auto n = static_cast<std::size_t>(last - p);
+                    std::uint64_t mask = 0;
+                    if (n >= block_size && kernel_.enabled()) {
+                        n = block_size;
+                        mask = kernel_(p);
+                    } else {
+                        n = n < block_size ? n : block_size;
+                        for (std::size_t i = 0; i < n; ++i) {
+                            mask |= static_cast<std::uint64_t>(static_cast<bool>(pred(p[i]))) << i;
+                        }
+                    }
+                    append_positions(mask, static_cast<std::size_t>(p - first), positions);
+                    p += n;
+                }
+            }
+
+        private:
+            Block kernel_{};
+            std::uint64_t mask_ = 0;
+            const Element* block_ = nullptr;
+            const Element* scan_ = nullptr;
+        };
+
+        struct no_cursor {
+            no_cursor() = default;
+            template<class Pred>
+            explicit constexpr no_cursor(const Pred&) {}
+        };
+
+        template<class Iterator, class Pred, class = void>
+        struct kernel_traits {
+            static constexpr bool enabled = false;
+            using cursor = no_cursor;
+        };
+
+        template<class Iterator, class Pred>
+        struct kernel_traits<Iterator, Pred, std::enable_if_t<std::contiguous_iterator<Iterator>,
+            std::void_t<typename Impl::block_for<Pred, std::iter_value_t<Iterator>>::type>>> {
+            static constexpr bool enabled = true;
+            using cursor = mask_cursor<typename Impl::block_for<Pred, std::iter_value_t<Iterator>>::type, std::iter_value_t<Iterator>>;
+        };
+
+        template<class Iterator, class Pred>
+        inline constexpr bool is_kernel_v = kernel_traits<Iterator, Pred>::enabled;
+    }
+}
+
+#endif //FILTERITERATOR_SIMD_HPP
@@ -0,0 +1,77 @@
+#ifndef FILTERITERATOR_STATS_HPP
+#define FILTERITERATOR_STATS_HPP
+
+#include <array>
+#include <bit>
+#include <cstddef>
+#include <type_traits>
+#include <utility>
+
+namespace iterator {
+    // Default stats policy of filter_range: records nothing and takes no space.
+    struct no_stats {};
+
+    // Sink for the scan statistics of an instrumented filter_range. Elements decided by a block
+    // mask of the SIMD kernels count as scanned, but not as predicate calls; block tails and
+    // blocks the kernel cannot evaluate call the predicate and count both.
+    struct scan_stats {
+        std::size_t predicate_calls = 0;
+        std::size_t scanned = 0;
+        std::size_t matches = 0;
+        // skip_histogram[k] counts scans that skipped [2^(k-1), 2^k) non-matching elements, [0] those that skipped none
+        std::array<std::size_t, 65> skip_histogram{};
+
+        constexpr void on_call() noexcept {++predicate_calls;}
+        constexpr void on_scan(std::size_t skipped, bool matched) noexcept {
+            if (skipped == 0 && !matched) {
+                return;
+            }
+            scanned += skipped;
+            if (matched) {
+                ++scanned;
+                ++matches;
+            }
+            ++skip_histogram[static_cast<std::size_t>(std::bit_width(skipped))];
+        }
+    };
+
+    namespace Impl {
+        template<class Stats, class = void>
+        inline constexpr bool is_stats_sink_v = false;
+        template<class Stats>
+        inline constexpr bool is_stats_sink_v<Stats, std::void_t<decltype(std::declval<Stats&>().on_call()),
+            decltype(std::declval<Stats&>().on_scan(std::size_t{}, bool{}))>> = true;
+
+        template<class Stats>
+        class stats_handle {
+        public:
+            stats_handle() = default;
+            explicit constexpr stats_handle(Stats& sink) noexcept: sink_(&sink) {}
+
+            constexpr void call() const {sink_->on_call();}
+            constexpr void scan(std::size_t skipped, bool matched) const {sink_->on_scan(skipped, matched);}
+            // pred recording each call, for the block cursors that call it on tails and unblocked values
+            template<class Pred>
+            constexpr auto counted(const Pred& pred) const {
+                return [sink = sink_, &pred](const auto& x) {
+                    sink->on_call();
+                    return pred(x);
+                };
+            }
+
+        private:
+            Stats* sink_ = nullptr;
+        };
+
+        template<>
+        class stats_handle<no_stats> {
+        public:
+            constexpr void call() const noexcept {}
+            constexpr void scan(std::size_t, bool) const noexcept {}
+            template<class Pred>
+            constexpr const Pred& counted(const Pred& pred) const noexcept {return pred;}
+        };
+    }
+}
+
+#endif //FILTERITERATOR_STATS_HPP
@@ -7,12 +7,32 @@
 #include <array>
 #include <deque>
 #include <list>
+#include <string>
+#include <atomic>
+#include <mutex>
+#include <chrono>
+#include <thread>
+#include <forward_list>
+#include <map>
+#include <ranges>
+#include <numeric>
+#include <span>
+#include <sstream>
+#include <fstream>
+#include <filesystem>
+#include <memory_resource>
 
 #if defined(USE_CONCEPTS)
 #include "filteriterator.hpp"
 #else
 #include "filteriterator_SFINAE.hpp"
 #endif
+#include "filteriterator_algorithm.hpp"
+#include "filteriterator_parallel.hpp"
+#include "filteriterator_prefetch.hpp"
+#include "filteriterator_mmap.hpp"
+#include "filteriterator_arena.hpp"
+#include "filteriterator_dsl.hpp"
 
 struct CustomStruct {
     int id;
@@ -226,6 +246,647 @@ TYPED_TEST(FilterIteratorParamTest, CStyle) {
     }
 }
 
+TYPED_TEST(FilterIteratorParamTest, ConstexprFilter) {
+    using paramtype = TypeParam;
+    static constexpr paramtype arr[6] = {6, 9, 0, 1, 2, 3};
+    constexpr auto big = [](paramtype v){ return v > 2; };
+    constexpr auto n = iterator::filter_range(std::begin(arr), std::end(arr), big).size();
+    static_assert(n == 3);
+    constexpr auto from_c_array = iterator::filter_to_array<n>(arr, big);
+    static_assert(from_c_array == std::array<paramtype, 3>{6, 9, 3});
+
+    static constexpr std::array<paramtype, 6> table = {6, 9, 0, 1, 2, 3};
+    // pred::compare takes the plain scan during constant evaluation and the kernels at run time
+    constexpr auto from_std_array = iterator::filter_to_array<3>(table, iterator::pred::greater(2));
+    static_assert(from_std_array == from_c_array);
+    static_assert(iterator::filter_to_array<2>(table, iterator::pred::all_of(big, iterator::pred::not_(iterator::pred::equal_to(9))))
+        == std::array<paramtype, 2>{6, 3});
+    static_assert([] {
+        auto range = iterator::filter_range(std::begin(arr), std::end(arr), iterator::pred::less(3));
+        auto it = range.end();
+        --it;
+        return *it == 2 && *range.begin() == 0 && range.size() == 3 && !range.empty();
+    }());
+    EXPECT_EQ(iterator::filter_to_array<3>(table, iterator::pred::greater(2)), from_c_array);
+    EXPECT_THROW(iterator::filter_to_array<2>(table, big), std::length_error);
+}
+
+template <iterator::pred::cmp Op, typename T, typename V>
+void check_simd_kernel(const std::vector<T>& data, V value) {
+    auto expected_range = iterator::filter_range(data.begin(), data.end(), [value](T x){
+        return iterator::pred::compare<Op, V>{value}(x);
+    });
+    std::vector<T> expected(expected_range.begin(), expected_range.end());
+
+    for (auto isa : {iterator::simd::isa::scalar, iterator::simd::isa::sse2, iterator::simd::isa::avx2}) {
+        iterator::simd::set_max_isa(isa);
+        auto range = iterator::filter_range(data.begin(), data.end(), iterator::pred::compare<Op, V>{value});
+        std::vector<T> result(range.begin(), range.end());
+        EXPECT_EQ(result, expected) << "isa " << static_cast<int>(isa) << " op " << static_cast<int>(Op);
+    }
+    iterator::simd::set_max_isa(iterator::simd::isa::avx2);
+}
+
+TYPED_TEST(FilterIteratorParamTest, SimdKernel) {
+    using paramtype = TypeParam;
+    using namespace iterator::pred;
+    static_assert(iterator::simd::is_kernel_v<typename std::vector<paramtype>::iterator, compare<cmp::gt, int>>);
+    static_assert(!iterator::simd::is_kernel_v<typename std::deque<paramtype>::iterator, compare<cmp::gt, int>>);
+
+    paramtype arr[6] = {6, 9, 0, 1, 2, 3};
+    auto c_range = iterator::filter_range(std::begin(arr), std::end(arr), greater(2));
+    std::vector<paramtype> c_result(c_range.begin(), c_range.end());
+    EXPECT_EQ(c_result, (std::vector<paramtype>{6, 9, 3}));
+
+    std::vector<paramtype> data(301);
+    std::mt19937 gen(7);
+    std::uniform_int_distribution<> distrib(0, 100);
+    for (auto& v : data) {
+        v = static_cast<paramtype>(distrib(gen));
+    }
+    check_simd_kernel<cmp::gt>(data, 50);
+    check_simd_kernel<cmp::ge>(data, 50);
+    check_simd_kernel<cmp::lt>(data, 3);
+    check_simd_kernel<cmp::le>(data, 3);
+    check_simd_kernel<cmp::eq>(data, 42);
+    check_simd_kernel<cmp::ne>(data, 42);
+    // not representable in the element type: falls back to per-element calls
+    check_simd_kernel<cmp::gt>(data, 50.5);
+    check_simd_kernel<cmp::gt>(data, -1000);
+    check_simd_kernel<cmp::lt>(data, 100000);
+    // floating-point bounds on integral elements, integral bounds beyond the exact range of floating-point elements
+    check_simd_kernel<cmp::gt>(data, 50.0);
+    check_simd_kernel<cmp::le>(data, 50.0f);
+    check_simd_kernel<cmp::lt>(data, 3e9f);
+    check_simd_kernel<cmp::gt>(data, -1e300);
+    check_simd_kernel<cmp::ne>(data, std::numeric_limits<double>::quiet_NaN());
+    check_simd_kernel<cmp::gt>(data, std::numeric_limits<long>::max());
+    check_simd_kernel<cmp::lt>(data, std::numeric_limits<long>::min());
+}
+
+TEST(FilterIteratorTypedTest, SimdRepresentable) {
+    using iterator::simd::representable;
+    static_assert(representable<int>(50.0) && !representable<int>(50.5));
+    static_assert(!representable<int>(3e9f) && !representable<int>(-1e300) && !representable<int>(std::numeric_limits<double>::infinity()));
+    static_assert(representable<short>(-32768.0f) && !representable<short>(32768.0f));
+    // long converts to double inexactly, so pred::compare compares in double and the kernel cannot
+    static_assert(!representable<long>(1.0));
+    static_assert(representable<double>(std::numeric_limits<long>::max()) && representable<float>(std::numeric_limits<long>::min()));
+    static_assert(!representable<float>(1e300) && !representable<float>(0.1) && representable<float>(0.5));
+    static_assert(!representable<double>(std::numeric_limits<double>::quiet_NaN()));
+
+    std::vector<double> huge;
+    for (int i = 0; i < 40; ++i) {
+        huge.insert(huge.end(), {9.3e18, 9.2233720368547758e18, 1e19, -1e19, 0.0});
+    }
+    auto range = iterator::filter_range(huge.begin(), huge.end(), iterator::pred::greater(std::numeric_limits<long>::max()));
+    std::vector<double> expected;
+    std::copy_if(huge.begin(), huge.end(), std::back_inserter(expected), [](double x){ return x > static_cast<double>(std::numeric_limits<long>::max()); });
+    EXPECT_EQ(std::vector<double>(range.begin(), range.end()), expected);
+    EXPECT_EQ(expected.size(), 80u);
+}
+
+template<class T, class Expr, class Expected>
+void check_dsl_expression(const std::vector<T>& data, Expr expr, Expected expected_pred) {
+    std::vector<T> expected;
+    std::copy_if(data.begin(), data.end(), std::back_inserter(expected), expected_pred);
+    for (auto isa : {iterator::simd::isa::scalar, iterator::simd::isa::sse2, iterator::simd::isa::avx2}) {
+        iterator::simd::set_max_isa(isa);
+        auto range = iterator::filter_range(data.begin(), data.end(), expr);
+        std::vector<T> result(range.begin(), range.end());
+        EXPECT_EQ(result, expected) << "isa " << static_cast<int>(isa);
+        EXPECT_EQ(range.size(), expected.size());
+    }
+    iterator::simd::set_max_isa(iterator::simd::isa::avx2);
+}
+
+TYPED_TEST(FilterIteratorParamTest, PredicateDsl) {
+    using paramtype = TypeParam;
+    using namespace iterator::dsl;
+    using iterator::pred::cmp;
+    using iterator::pred::compare;
+    using vector_iterator = typename std::vector<paramtype>::iterator;
+
+    auto between = _1 > 20 && _1 < 80;
+    static_assert(std::is_same_v<decltype(between), iterator::pred::all_of_t<compare<cmp::gt, int>, compare<cmp::lt, int>>>);
+    static_assert(std::is_same_v<decltype(20 < _1), compare<cmp::gt, int>>);
+    static_assert(iterator::simd::is_kernel_v<vector_iterator, decltype(between)>);
+    static_assert(iterator::simd::is_kernel_v<vector_iterator, decltype(!(_1 == 42) || _1 >= 90)>);
+    static_assert(!iterator::simd::is_kernel_v<typename std::deque<paramtype>::iterator, decltype(between)>);
+    static_assert(!iterator::simd::is_kernel_v<vector_iterator, decltype(_1 * 2 > 100)>);
+    static_assert(!iterator::simd::is_kernel_v<vector_iterator, decltype(_1 > 20 && _1 * 2 > 100)>);
+
+    std::vector<paramtype> data(301);
+    std::mt19937 gen(11);
+    std::uniform_int_distribution<> distrib(0, 100);
+    for (auto& v : data) {
+        v = static_cast<paramtype>(distrib(gen));
+    }
+    check_dsl_expression(data, between, [](paramtype x){return x > 20 && x < 80;});
+    check_dsl_expression(data, _1 < 10 || 90 <= _1, [](paramtype x){return x < 10 || x >= 90;});
+    check_dsl_expression(data, !(_1 == 42), [](paramtype x){return x != 42;});
+    check_dsl_expression(data, !(_1 > 20 && _1 < 80) || _1 == 50, [](paramtype x){return !(x > 20 && x < 80) || x == 50;});
+    check_dsl_expression(data, _1 >= 20 && _1 <= 80 && _1 != 50, [](paramtype x){return x >= 20 && x <= 80 && x != 50;});
+    // plain calls: arithmetic on the element, and a bound the kernels cannot hold
+    check_dsl_expression(data, _1 * 2 > 100, [](paramtype x){return x * 2 > 100;});
+    check_dsl_expression(data, _1 > 20 && _1 < 80.5, [](paramtype x){return x > 20 && static_cast<double>(x) < 80.5;});
+    check_dsl_expression(data, _1 > -1000 && _1 < 100000, [](paramtype){return true;});
+}
+
+TEST(FilterIteratorTypedTest, PredicateDslFields) {
+    struct Span {
+        int lo;
+        int hi;
+        double weight;
+    };
+    using namespace iterator::dsl;
+    std::vector<Span> spans;
+    for (int i = 0; i < 200; ++i) {
+        spans.push_back({i % 37, (i * 7) % 41, static_cast<double>(i % 10) / 2});
+    }
+    auto expr = field(&Span::lo) >= 10 && field(&Span::weight) < 2.5;
+    static_assert(iterator::simd::is_kernel_v<std::vector<Span>::iterator, decltype(expr)>);
+    auto range = iterator::filter_range(spans.begin(), spans.end(), expr);
+    EXPECT_EQ(static_cast<std::size_t>(std::ranges::count_if(spans, [](const Span& s){return s.lo >= 10 && s.weight < 2.5;})), range.size());
+    EXPECT_TRUE(std::ranges::all_of(range, [](const Span& s){return s.lo >= 10 && s.weight < 2.5;}));
+
+    auto ordered = field(&Span::lo) < field(&Span::hi);
+    static_assert(!iterator::simd::is_kernel_v<std::vector<Span>::iterator, decltype(ordered)>);
+    auto ordered_range = iterator::filter_range(spans.begin(), spans.end(), ordered || field(&Span::lo) == 0);
+    EXPECT_EQ(static_cast<std::size_t>(std::ranges::count_if(spans, [](const Span& s){return s.lo < s.hi || s.lo == 0;})), ordered_range.size());
+
+    std::vector vec = {1,2,3,4,5,6,7,8,9,10};
+    auto even = iterator::filter_range(vec.begin(), vec.end(), _1 % 2 == 0 && 8 > _1);
+    EXPECT_TRUE(std::ranges::equal(even, std::vector{2, 4, 6}));
+    auto shifted = iterator::filter_range(vec.begin(), vec.end(), 10 - _1 > 3 && (_1 & 1) == 1);
+    EXPECT_TRUE(std::ranges::equal(shifted, std::vector{1, 3, 5}));
+    static_assert((_1 > 5 && _1 < 9)(7) && !(_1 % 2 == 0)(7));
+}
+
+TEST(FilterIteratorTypedTest, SimdKernelIteration) {
+    std::vector<int> data(200);
+    for (std::size_t i = 0; i < data.size(); ++i) {
+        data[i] = static_cast<int>(i);
+    }
+    auto range = iterator::filter_range(data.begin(), data.end(), iterator::pred::greater_equal(60));
+    auto it = range.begin();
+    EXPECT_EQ(*it, 60);
+    auto it2 = it;
+    ++it;
+    EXPECT_EQ(*it, 61);
+    EXPECT_EQ(*++it2, 61);
+    EXPECT_EQ(*std::prev(range.end()), 199);
+    EXPECT_EQ(*std::next(--it, 100), 160);
+    EXPECT_EQ(std::distance(range.begin(), range.end()), 140);
+    EXPECT_EQ(*range.rbegin(), 199);
+}
+
+TYPED_TEST(FilterIteratorTypedTest, ParallelFilterCopy) {
+    using paramtype = typename TypeParam::value_type;
+    TypeParam data;
+    std::mt19937 gen(3);
+    std::uniform_int_distribution<> distrib(0, 100);
+    for (int i = 0; i < 1000; ++i) {
+        data.push_back(static_cast<paramtype>(distrib(gen)));
+    }
+    auto pred = [](paramtype v){ return v > 70; };
+    auto range = iterator::filter_range(data.begin(), data.end(), pred);
+    std::vector<paramtype> expected(range.begin(), range.end());
+
+    for (unsigned threads : {0u, 1u, 2u, 3u, 8u}) {
+        std::vector<paramtype> result(data.size());
+        auto result_end = iterator::parallel_filter_copy(data.begin(), data.end(), result.begin(), pred, threads);
+        result.erase(result_end, result.end());
+        EXPECT_EQ(result, expected) << threads << " threads";
+    }
+}
+
+TYPED_TEST(FilterIteratorTypedTest, BranchlessFilterCopy) {
+    using paramtype = typename TypeParam::value_type;
+    std::mt19937 gen(5);
+    std::uniform_int_distribution<> distrib(0, 99);
+    // random and clustered stretches over several blocks, plus a partial last block
+    for (int threshold : {0, 10, 50, 90, 100}) {
+        TypeParam data;
+        for (int i = 0; i < 10000; ++i) {
+            int value = (i / 3000) % 2 == 0 ? distrib(gen) : (i / 700) % 2 * 99;
+            data.push_back(static_cast<paramtype>(value));
+        }
+        auto pred = [threshold](paramtype v){ return static_cast<int>(v) < threshold; };
+        std::vector<paramtype> expected;
+        std::copy_if(data.begin(), data.end(), std::back_inserter(expected), pred);
+
+        std::vector<paramtype> result(data.size());
+        result.erase(iterator::filter_copy_branchless(data.begin(), data.end(), result.begin(), pred), result.end());
+        EXPECT_EQ(result, expected) << threshold;
+        result.assign(data.size(), paramtype{});
+        result.erase(iterator::filter_copy(data.begin(), data.end(), result.begin(), pred), result.end());
+        EXPECT_EQ(result, expected) << threshold;
+    }
+
+    std::list<paramtype> list;
+    for (int v : {1, 50, 2, 60}) {
+        list.push_back(static_cast<paramtype>(v));
+    }
+    paramtype out[4] = {};
+    EXPECT_EQ(iterator::filter_copy(list.begin(), list.end(), std::begin(out), [](paramtype v){ return v > 10; }), out + 2);
+    EXPECT_EQ(out[1], static_cast<paramtype>(60));
+}
+
+TEST(FilterIteratorTypedTest, PartitionInto) {
+    std::vector<int> data(5000);
+    std::mt19937 gen(11);
+    std::uniform_int_distribution<> distrib(0, 999);
+    for (auto& v : data) {
+        v = distrib(gen);
+    }
+    auto classify = [](int v){ return v < 100 ? 0 : v % 2 == 0 ? 1 : 2; };
+    std::vector<int> small;
+    std::list<int> even;
+    std::vector<int> odd(data.size());
+    auto [small_end, even_end, odd_end] = iterator::partition_into(data.begin(), data.end(), classify,
+        std::back_inserter(small), std::back_inserter(even), odd.begin());
+    static_cast<void>(small_end);
+    static_cast<void>(even_end);
+    odd.erase(odd_end, odd.end());
+    auto expected = [&](int bucket) {
+        std::vector<int> matches;
+        std::copy_if(data.begin(), data.end(), std::back_inserter(matches), [&](int v){ return classify(v) == bucket; });
+        return matches;
+    };
+    EXPECT_EQ(small, expected(0));
+    EXPECT_TRUE(std::ranges::equal(even, expected(1)));
+    EXPECT_EQ(odd, expected(2));
+
+    // more buckets than a buffer holds elements, and buffers left partly filled
+    std::array<std::vector<int>, 16> direct;
+    std::array<std::vector<int>, 16> combined;
+    auto by_value = [](int v){ return static_cast<std::size_t>(v) % 16; };
+    auto route = [&](auto partition, std::array<std::vector<int>, 16>& out) {
+        std::array<int*, 16> outs{};
+        for (std::size_t b = 0; b < out.size(); ++b) {
+            out[b].resize(data.size());
+            outs[b] = out[b].data();
+        }
+        auto ends = std::apply([&](auto... o) {return partition(data.begin(), data.end(), by_value, o...);}, outs);
+        std::apply([&](auto... e) {
+            std::size_t b = 0;
+            ((out[b].resize(static_cast<std::size_t>(e - out[b].data())), ++b), ...);
+        }, ends);
+    };
+    route([](auto... args) {return iterator::partition_into(args...);}, direct);
+    route([](auto... args) {return iterator::partition_into_combined(args...);}, combined);
+    EXPECT_EQ(direct, combined);
+    for (std::size_t b = 0; b < direct.size(); ++b) {
+        std::vector<int> bucket;
+        std::copy_if(data.begin(), data.end(), std::back_inserter(bucket), [&](int v){ return by_value(v) == b; });
+        EXPECT_EQ(direct[b], bucket) << b;
+    }
+
+    std::vector<CustomStruct> people = {{1, "Kovalenko Pavel"}, {2, "Kvasnikov Lev"}, {3, "Trifautsan Artem"}};
+    std::vector<CustomStruct> first;
+    std::vector<CustomStruct> rest;
+    iterator::partition_into(people.begin(), people.end(), [](const CustomStruct& p){ return p.data.starts_with("K") ? 0u : 1u; },
+        std::back_inserter(first), std::back_inserter(rest));
+    EXPECT_EQ(first.size(), 2u);
+    EXPECT_EQ(rest, (std::vector<CustomStruct>{{3, "Trifautsan Artem"}}));
+
+    // a bucket index outside the outputs throws on both paths, negative ones included, after
+    // the elements before it are written
+    std::vector<int> values = {0, 1, 2, 1};
+    std::vector<int> low;
+    std::vector<int> high;
+    auto past_end = [](int v){ return static_cast<std::size_t>(v); };
+    EXPECT_THROW(iterator::partition_into(values.begin(), values.end(), past_end, std::back_inserter(low), std::back_inserter(high)), std::out_of_range);
+    EXPECT_EQ(low, (std::vector<int>{0}));
+    EXPECT_EQ(high, (std::vector<int>{1}));
+    std::vector<int> low_combined;
+    std::vector<int> high_combined;
+    EXPECT_THROW(iterator::partition_into_combined(values.begin(), values.end(), past_end,
+        std::back_inserter(low_combined), std::back_inserter(high_combined)), std::out_of_range);
+    EXPECT_EQ(low_combined, low);
+    EXPECT_EQ(high_combined, high);
+    auto negative = [](int v){ return v - 1; };
+    EXPECT_THROW(iterator::partition_into(values.begin(), values.end(), negative, low.begin(), high.begin()), std::out_of_range);
+    EXPECT_THROW(iterator::partition_into_combined(values.begin(), values.end(), negative, low.begin(), high.begin()), std::out_of_range);
+}
+
+TYPED_TEST(FilterIteratorTypedTest, NextBatch) {
+    using paramtype = typename TypeParam::value_type;
+    TypeParam data;
+    for (int i = 0; i < 100; ++i) {
+        data.push_back(static_cast<paramtype>(i % 10));
+    }
+    auto range = iterator::filter_range(data.begin(), data.end(), [](paramtype v){ return v > 6; });
+    auto it = range.begin();
+    std::array<paramtype*, 7> pointers{};
+    std::array<std::size_t, 7> indices{};
+    std::vector<std::size_t> seen;
+    // alternate batches of addresses, batches of indices and single steps
+    for (int round = 0; it != range.end(); ++round) {
+        if (round % 3 == 0) {
+            std::size_t n = it.next_batch(std::span(pointers));
+            for (std::size_t i = 0; i < n; ++i) {
+                auto found = std::find_if(data.begin(), data.end(), [&](const paramtype& v){ return &v == pointers[i]; });
+                seen.push_back(static_cast<std::size_t>(std::distance(data.begin(), found)));
+            }
+        } else if (round % 3 == 1) {
+            std::size_t n = it.next_batch(std::span(indices));
+            seen.insert(seen.end(), indices.begin(), indices.begin() + static_cast<std::ptrdiff_t>(n));
+        } else {
+            seen.push_back(static_cast<std::size_t>(std::distance(data.begin(), it.base())));
+            ++it;
+        }
+    }
+    std::vector<std::size_t> expected;
+    for (std::size_t i = 0; i < data.size(); ++i) {
+        if (i % 10 > 6) {
+            expected.push_back(i);
+        }
+    }
+    EXPECT_EQ(seen, expected);
+    EXPECT_EQ(it.next_batch(std::span(pointers)), 0u);
+}
+
+TYPED_TEST(FilterIteratorTypedTest, SelectIndices) {
+    using paramtype = typename TypeParam::value_type;
+    TypeParam data;
+    for (int i = 0; i < 1000; ++i) {
+        data.push_back(static_cast<paramtype>((i * 37) % 101));
+    }
+    std::vector<std::uint32_t> expected;
+    for (std::uint32_t i = 0; i < data.size(); ++i) {
+        if (data[i] > static_cast<paramtype>(70)) {
+            expected.push_back(i);
+        }
+    }
+    auto lambda = iterator::filter_range(data.begin(), data.end(), [](paramtype v){ return v > static_cast<paramtype>(70); });
+    EXPECT_EQ(lambda.select_indices(), expected);
+    auto compare = iterator::filter_range(data.begin(), data.end(), iterator::pred::greater(70));
+    EXPECT_EQ(compare.select_indices(), expected);
+    auto wide = compare.template select_indices<std::uint64_t>();
+    EXPECT_TRUE(std::ranges::equal(wide, expected));
+    EXPECT_EQ(compare.size(), expected.size());
+
+    auto none = iterator::filter_range(data.begin(), data.begin(), iterator::pred::greater(70));
+    EXPECT_TRUE(none.select_indices().empty());
+    EXPECT_THROW(compare.template select_indices<std::uint8_t>(), std::length_error);
+}
+
+TEST(FilterIteratorTypedTest, ToContainer) {
+    std::vector<int> data(10000);
+    std::mt19937 gen(3);
+    std::uniform_int_distribution<> distrib(0, 999);
+    for (auto& v : data) {
+        v = distrib(gen);
+    }
+    std::vector<int> expected;
+    std::copy_if(data.begin(), data.end(), std::back_inserter(expected), [](int v){ return v > 700; });
+
+    auto kernel = iterator::filter_range(data.begin(), data.end(), iterator::pred::greater(700));
+    auto exact = kernel.to<std::vector<int>>();
+    EXPECT_EQ(exact, expected);
+    EXPECT_EQ(exact.capacity(), expected.size());
+
+    auto lambda = iterator::filter_range(data.begin(), data.end(), [](int v){ return v > 700; });
+    auto sampled = lambda.to<std::vector<int>>();
+    EXPECT_EQ(sampled, expected);
+    EXPECT_GE(sampled.capacity(), expected.size());
+    EXPECT_LT(sampled.capacity(), 2 * expected.size());
+
+    std::pmr::monotonic_buffer_resource resource;
+    auto pmr = lambda.to<std::pmr::vector<int>>(&resource);
+    EXPECT_TRUE(std::ranges::equal(pmr, expected));
+    EXPECT_EQ(pmr.get_allocator().resource(), &resource);
+
+    iterator::arena arena(4096);
+    auto in_arena = kernel.to<std::vector<int, iterator::arena_allocator<int>>>(iterator::arena_allocator<int>(arena));
+    EXPECT_TRUE(std::ranges::equal(in_arena, expected));
+    EXPECT_EQ(arena.used(), expected.size() * sizeof(int));
+    auto pmr_arena = kernel.to<std::pmr::vector<int>>(&arena);
+    EXPECT_EQ(arena.used(), 2 * expected.size() * sizeof(int));
+    EXPECT_EQ(reinterpret_cast<std::uintptr_t>(pmr_arena.data()) % alignof(int), 0u);
+    const auto capacity = arena.capacity();
+    arena.reset();
+    EXPECT_EQ(arena.used(), 0u);
+    auto reused = kernel.to<std::pmr::vector<int>>(&arena);
+    EXPECT_TRUE(std::ranges::equal(reused, expected));
+    EXPECT_EQ(arena.capacity(), capacity);
+
+    std::list<int> list(data.begin(), data.end());
+    auto from_list = iterator::filter_range(list.begin(), list.end(), [](int v){ return v > 700; }).to<std::deque<int>>();
+    EXPECT_TRUE(std::ranges::equal(from_list, expected));
+
+    std::vector<CustomStruct> people = {{1, "Kovalenko Pavel"}, {2, "Kvasnikov Lev"}, {3, "Trifautsan Artem"}};
+    auto names = iterator::filter_range(people.begin(), people.end(), [](const std::string& name){ return name.starts_with("K"); }, &CustomStruct::data);
+    EXPECT_EQ(names.to<std::vector<CustomStruct>>().size(), 2u);
+}
+
+TEST(FilterIteratorTypedTest, NextBatchNodeBased) {
+    std::list<int> data = {4, 8, 1, 9, 12};
+    auto range = iterator::filter_range(data.begin(), data.end(), [](int v){ return v > 5; });
+    std::array<int*, 2> out{};
+    auto it = range.begin();
+    EXPECT_EQ(it.next_batch(std::span(out)), 2u);
+    EXPECT_EQ(*out[0], 8);
+    EXPECT_EQ(*out[1], 9);
+    EXPECT_EQ(*it, 12);
+    EXPECT_EQ(it.next_batch(std::span(out)), 1u);
+    EXPECT_EQ(out[0], &data.back());
+    EXPECT_EQ(it, range.end());
+
+    std::vector<int> values(1000);
+    std::iota(values.begin(), values.end(), 0);
+    auto simd = iterator::filter_range(values.begin(), values.end(), iterator::pred::greater_equal(990));
+    std::array<std::size_t, 256> indices{};
+    auto first = simd.begin();
+    EXPECT_EQ(first.next_batch(std::span(indices)), 10u);
+    EXPECT_EQ(indices[9], 999u);
+}
+
+TEST(FilterIteratorTypedTest, ParallelFilterCopyEdgeCases) {
+    std::vector<int> empty;
+    std::vector<int> out(4);
+    EXPECT_EQ(iterator::parallel_filter_copy(empty.begin(), empty.end(), out.begin(), [](int){ return true; }, 4), out.begin());
+
+    int arr[] = {5, 1, 7};
+    EXPECT_EQ(iterator::parallel_filter_copy(std::begin(arr), std::end(arr), out.begin(), [](int v){ return v > 2; }, 16), out.begin() + 2);
+    EXPECT_EQ(out[0], 5);
+    EXPECT_EQ(out[1], 7);
+
+    EXPECT_THROW(iterator::parallel_filter_copy(std::begin(arr), std::end(arr), out.begin(), [](int v) -> bool {
+        if (v == 7) {
+            throw std::runtime_error("bad element");
+        }
+        return true;
+    }, 3), std::runtime_error);
+}
+
+TYPED_TEST(FilterIteratorTypedTest, ParallelForEach) {
+    using paramtype = typename TypeParam::value_type;
+    TypeParam data;
+    for (int i = 0; i < 5000; ++i) {
+        data.push_back(static_cast<paramtype>(i % 100));
+    }
+    auto range = iterator::filter_range(data.begin(), data.end(), [](paramtype v){ return v > 89; });
+    std::vector<paramtype> expected(range.begin(), range.end());
+
+    iterator::work_stealing_pool pool(4);
+    std::mutex mutex;
+    std::vector<paramtype> result;
+    auto stats = iterator::parallel_for_each(range, [&](paramtype v) {
+        std::lock_guard lock(mutex);
+        result.push_back(v);
+    }, pool, 64);
+
+    ASSERT_EQ(stats.size(), 4u);
+    std::size_t scanned = 0;
+    std::size_t matched = 0;
+    for (auto& s : stats) {
+        scanned += s.scanned;
+        matched += s.matched;
+    }
+    EXPECT_EQ(scanned, data.size());
+    EXPECT_EQ(matched, expected.size());
+    std::sort(result.begin(), result.end());
+    std::sort(expected.begin(), expected.end());
+    EXPECT_EQ(result, expected);
+}
+
+TEST(FilterIteratorTypedTest, ParallelForEachClustered) {
+    std::vector<int> data(20000, 0);
+    std::fill(data.end() - 500, data.end(), 1);
+    int arr[] = {1, 0, 1};
+    iterator::work_stealing_pool pool(3);
+
+    for (int round = 0; round < 3; ++round) {
+        std::atomic<long long> sum{0};
+        auto range = iterator::filter_range(data.begin(), data.end(), [](int v){ return v == 1; });
+        auto stats = iterator::parallel_for_each(range, [&](int& v) {
+            std::this_thread::sleep_for(std::chrono::microseconds(1));
+            sum += v;
+        }, pool, 16);
+        EXPECT_EQ(sum.load(), 500);
+        std::size_t matched = 0;
+        for (auto& s : stats) {
+            matched += s.matched;
+        }
+        EXPECT_EQ(matched, 500u);
+    }
+
+    auto c_range = iterator::filter_range(std::begin(arr), std::end(arr), [](int v){ return v == 1; });
+    std::atomic<int> calls{0};
+    iterator::parallel_for_each(c_range, [&](int) { ++calls; }, pool, 1);
+    EXPECT_EQ(calls.load(), 2);
+
+    EXPECT_THROW(iterator::parallel_for_each(c_range, [](int) { throw std::runtime_error("visitor failed"); }, pool, 1),
+        std::runtime_error);
+    calls = 0;
+    iterator::parallel_for_each(c_range, [&](int) { ++calls; }, pool, 1);
+    EXPECT_EQ(calls.load(), 2);
+}
+
+TEST(FilterIteratorTypedTest, NullTerminatedSentinel) {
+    const char text[] = "filter iterator";
+    const char* first = text;
+    int calls = 0;
+    auto range = iterator::filter_range(first, iterator::value_sentinel<char>{'\0'}, [&calls](char c) {
+        ++calls;
+        return c == 'i' || c == 'e' || c == 'o';
+    });
+    static_assert(std::is_same_v<decltype(range.end()), iterator::Impl::filter_sentinel<iterator::value_sentinel<char>>>);
+    static_assert(sizeof(decltype(range.end())) == sizeof(char));
+    static_assert(std::sentinel_for<iterator::value_sentinel<char>, const char*>);
+    // only iterators whose element compares with the value are ended by it
+    static_assert(!std::sentinel_for<iterator::value_sentinel<std::string>, std::list<int>::iterator>);
+    static_assert(!std::sentinel_for<iterator::value_sentinel<char>, int>);
+
+    std::string result;
+    for (char c : range) {
+        result += c;
+    }
+    EXPECT_EQ(result, "ieieo");
+    EXPECT_EQ(calls, 15);
+    EXPECT_TRUE(range.begin() != range.end());
+}
+
+TEST(FilterIteratorTypedTest, DelimiterTerminatedRecords) {
+    std::list<int> records = {4, 7, 10, -1, 12, 14};
+    auto range = iterator::filter_range(records.begin(), iterator::value_sentinel<int>{-1}, [](int v){ return v % 2 == 0; });
+    std::vector<int> result;
+    for (auto it = range.begin(); it != range.end(); ++it) {
+        result.push_back(*it);
+    }
+    EXPECT_EQ(result, (std::vector<int>{4, 10}));
+
+    std::vector<int> empty_record = {-1, 2};
+    auto empty = iterator::filter_range(empty_record.begin(), iterator::value_sentinel<int>{-1}, [](int){ return true; });
+    EXPECT_TRUE(empty.begin() == empty.end());
+}
+
+TEST(FilterIteratorTypedTest, RangesView) {
+    std::vector vec = {1,2,3,4,5,6,7,8,9,10};
+    auto even = [](int v){ return v % 2 == 0; };
+    using lambda_range = decltype(iterator::filter_range(vec.begin(), vec.end(), even));
+    using capturing_range = decltype(iterator::filter_range(vec.begin(), vec.end(), [&vec](int v){ return v > vec[0]; }));
+    using function_range = decltype(iterator::filter_range(vec.begin(), vec.end(), std::function<bool(int)>{}));
+    using list_range = decltype(iterator::filter_range(std::list<int>{}.begin(), std::list<int>{}.end(), even));
+    using forward_range = decltype(iterator::filter_range(std::forward_list<int>{}.begin(), std::forward_list<int>{}.end(), even));
+    static_assert(std::ranges::view<lambda_range>);
+    static_assert(std::ranges::view<capturing_range>);
+    static_assert(std::ranges::view<function_range>);
+    static_assert(std::ranges::bidirectional_range<lambda_range>);
+    static_assert(std::ranges::common_range<lambda_range>);
+    static_assert(std::ranges::bidirectional_range<list_range>);
+    static_assert(std::ranges::forward_range<forward_range> && !std::ranges::bidirectional_range<forward_range>);
+    static_assert(std::ranges::borrowed_range<lambda_range>);
+    static_assert(!std::ranges::borrowed_range<capturing_range>);
+    static_assert(!std::ranges::borrowed_range<function_range>);
+    // single-pass iterators point at the source iterator stored in the range
+    using stream_range = decltype(iterator::filter_range(std::istream_iterator<int>(), std::istream_iterator<int>(), even));
+    static_assert(!std::ranges::borrowed_range<stream_range>);
+    static_assert(std::ranges::viewable_range<lambda_range>);
+
+    auto piped = vec | iterator::views::filter(even) | std::views::take(3);
+    EXPECT_TRUE(std::ranges::equal(piped, std::vector{2, 4, 6}));
+    auto called = iterator::views::filter(vec, [](int v){ return v > 7; });
+    EXPECT_TRUE(std::ranges::equal(called, std::vector{8, 9, 10}));
+    EXPECT_TRUE(std::ranges::equal(called | std::views::reverse, std::vector{10, 9, 8}));
+    EXPECT_EQ(called.front(), 8);
+    EXPECT_FALSE(called.empty());
+
+    int threshold = 3;
+    auto above = vec | iterator::views::filter([threshold](int v){ return v > threshold; });
+    auto chained = above | iterator::views::filter(even);
+    EXPECT_TRUE(std::ranges::equal(chained, std::vector{4, 6, 8, 10}));
+    auto copy = chained;
+    copy = chained;
+    EXPECT_TRUE(std::ranges::equal(copy, std::vector{4, 6, 8, 10}));
+
+    auto borrowed = std::ranges::find(iterator::views::filter(std::views::all(vec), even), 4);
+    static_assert(!std::is_same_v<decltype(borrowed), std::ranges::dangling>);
+    EXPECT_EQ(*borrowed, 4);
+
+    std::list<int> lst = {5, 3, 8, 1};
+    auto from_list = lst | iterator::views::filter([](int v){ return v > 2; }) | std::views::transform([](int v){ return v * 10; });
+    EXPECT_TRUE(std::ranges::equal(from_list, std::vector{50, 30, 80}));
+
+    // temporaries that are not borrowed are moved into a filter_view
+    auto doubled = vec | std::views::transform([](int v){ return v * 2; }) | iterator::views::filter([](int v){ return v > 12; });
+    static_assert(std::ranges::view<decltype(doubled)> && std::ranges::bidirectional_range<decltype(doubled)>);
+    EXPECT_TRUE(std::ranges::equal(doubled, std::vector{14, 16, 18, 20}));
+    EXPECT_TRUE(std::ranges::equal(doubled | std::views::reverse | std::views::take(2), std::vector{20, 18}));
+    auto moved = std::move(doubled);
+    EXPECT_EQ(moved.front(), 14);
+
+    auto owned = std::vector{7, 2, 9, 4} | iterator::views::filter(even);
+    static_assert(!std::ranges::borrowed_range<decltype(owned)>);
+    EXPECT_TRUE(std::ranges::equal(owned, std::vector{2, 4}));
+    EXPECT_TRUE(std::ranges::equal(iterator::views::filter(std::views::iota(0, 40) | std::views::filter(even), [](int v){ return v % 3 == 0; }),
+        std::vector{0, 6, 12, 18, 24, 30, 36}));
+    static_assert(std::is_same_v<decltype(std::ranges::find(std::vector{1, 2} | iterator::views::filter(even), 2)), std::ranges::dangling>);
+}
+
 TEST(FilterIteratorTypedTest, CustomType) {
     std::vector<CustomStruct> data = {{1, "Kovalenko Pavel"}, {2, "Kvasnikov Lev"},
         {3, "Trifautsan Artem"}, {4, "Shidlovskaia Kristina"}};
@@ -239,6 +900,36 @@ TEST(FilterIteratorTypedTest, CustomType) {
     EXPECT_EQ(result, expected);
 }
 
+TEST(FilterIteratorTypedTest, Projection) {
+    std::vector<CustomStruct> data;
+    for (int i = 0; i < 300; ++i) {
+        data.push_back({(i * 7) % 100, "customer " + std::to_string(i)});
+    }
+    auto by_id = [](const CustomStruct& s){ return s.id > 90; };
+    std::vector<CustomStruct> expected;
+    std::copy_if(data.begin(), data.end(), std::back_inserter(expected), by_id);
+
+    auto kernel = iterator::filter_range(data.begin(), data.end(), iterator::pred::greater(90), &CustomStruct::id);
+    static_assert(iterator::simd::is_kernel_v<std::vector<CustomStruct>::iterator, decltype(kernel)::Predicate>);
+    EXPECT_EQ(std::vector<CustomStruct>(kernel.begin(), kernel.end()), expected);
+    EXPECT_EQ(kernel.size(), expected.size());
+    std::vector<CustomStruct> reversed(kernel.rbegin(), kernel.rend());
+    EXPECT_TRUE(std::ranges::equal(reversed, expected | std::views::reverse));
+
+    auto field = &CustomStruct::data;
+    auto named = iterator::filter_range(data.begin(), data.end(), [](const std::string& name){ return name.ends_with("99"); }, field);
+    ASSERT_EQ(std::ranges::distance(named), 3);
+    EXPECT_EQ(named.begin()->data, "customer 99");
+
+    std::list<CustomStruct> list(data.begin(), data.end());
+    auto node_based = iterator::filter_range(list.begin(), list.end(), iterator::pred::greater(90), &CustomStruct::id);
+    static_assert(!iterator::simd::is_kernel_v<std::list<CustomStruct>::iterator, decltype(node_based)::Predicate>);
+    EXPECT_TRUE(std::ranges::equal(node_based, expected));
+
+    auto squared = iterator::filter_range(data.begin(), data.end(), iterator::pred::greater(8100), [](const CustomStruct& s){ return s.id * s.id; });
+    EXPECT_TRUE(std::ranges::equal(squared, expected));
+}
+
 TYPED_TEST(FilterIteratorTypedTest, Operators) {
 
     using paramtype = typename TypeParam::value_type;
@@ -288,6 +979,48 @@ TEST(FilterIteratorTypedTest, TestMemberOper) {
     EXPECT_EQ((it1)->data(), data[1].data());
 }
 
+TYPED_TEST(FilterIteratorTypedTest, Bidirectional) {
+    using paramtype = typename TypeParam::value_type;
+    TypeParam data = {static_cast<paramtype>(10), static_cast<paramtype>(1), static_cast<paramtype>(20),
+        static_cast<paramtype>(3), static_cast<paramtype>(30), static_cast<paramtype>(5)};
+    auto range = iterator::filter_range(data.begin(), data.end(), [](paramtype v){ return static_cast<int>(v) % 10 == 0; });
+    static_assert(std::is_same_v<typename decltype(range)::iterator::iterator_category, std::bidirectional_iterator_tag>);
+
+    auto it = std::prev(range.end());
+    EXPECT_EQ(*it, static_cast<paramtype>(30));
+    --it;
+    EXPECT_EQ(*it, static_cast<paramtype>(20));
+    it--;
+    EXPECT_EQ(*it, static_cast<paramtype>(10));
+    EXPECT_EQ(it, range.begin());
+
+    TypeParam result;
+    std::copy(range.rbegin(), range.rend(), std::back_inserter(result));
+    TypeParam expected = {30, 20, 10};
+    EXPECT_EQ(result, expected);
+}
+
+TEST(FilterIteratorTypedTest, BidirectionalList) {
+    std::list<int> data = {1, 2, 3, 4, 5, 6};
+    auto range = iterator::filter_range(data.begin(), data.end(), [](int v){ return v % 2 == 1; });
+    std::vector<int> result(range.rbegin(), range.rend());
+    EXPECT_EQ(result, (std::vector<int>{5, 3, 1}));
+    EXPECT_EQ(*std::prev(range.end(), 2), 3);
+
+    int arr[] = {2, 4, 6};
+    auto empty = iterator::filter_range(std::begin(arr), std::end(arr), [](int v){ return v % 2 == 1; });
+    EXPECT_EQ(empty.rbegin(), empty.rend());
+}
+
+TEST(FilterIteratorTypedTest, ForwardOnly) {
+    std::forward_list<int> data = {1, 2, 3, 4};
+    auto range = iterator::filter_range(data.begin(), data.end(), [](int v){ return v > 2; });
+    static_assert(std::is_same_v<decltype(range)::iterator::iterator_category, std::forward_iterator_tag>);
+    static_assert(sizeof(decltype(range)::iterator) == 2 * sizeof(std::forward_list<int>::iterator));
+    std::vector<int> result(range.begin(), range.end());
+    EXPECT_EQ(result, (std::vector<int>{3, 4}));
+}
+
 class MyComp {
     public:
     bool operator()(int a) {
@@ -311,10 +1044,502 @@ TEST(FilterIteratorTypedTest, CompareFunctionBehavior) {
     Comp(0);
     EXPECT_EQ(Comp.get(), 10);
     auto it = range.begin();
-    EXPECT_EQ(Comp.get(), 13);
+    EXPECT_EQ(Comp.get(), 10);
+    ++it;
+    EXPECT_EQ(Comp.get(), 11);
+    EXPECT_EQ(result, expected);
+}
+
+template<class Range>
+concept ConstIterable = requires(const Range& range) { range.begin(); range.end(); };
+
+TEST(FilterIteratorTypedTest, ConcurrentIteration) {
+    std::vector<int> vec(4096);
+    std::iota(vec.begin(), vec.end(), 0);
+    std::vector<int> expected;
+    std::copy_if(vec.begin(), vec.end(), std::back_inserter(expected), [](int v){ return v > 2 && v % 3 != 0; });
+
+    static_assert(!ConstIterable<decltype(iterator::filter_range(vec.begin(), vec.end(), MyComp{}))>);
+    static_assert(ConstIterable<decltype(iterator::filter_range(vec.begin(), vec.end(), iterator::pred::per_iterator(MyComp{})))>);
+    iterator::scan_stats stats;
+    static_assert(!ConstIterable<decltype(iterator::filter_range(vec.begin(), vec.end(), [](int v){ return v > 2; }, stats))>);
+
+    // every thread, and every iterator, calls its own copy of the stateful predicate
+    const auto copied = iterator::filter_range(vec.begin(), vec.end(), iterator::pred::per_iterator(
+        iterator::pred::all_of(MyComp{}, [](int v){ return v % 3 != 0; })));
+    int threshold = 3;
+    const auto shared = iterator::filter_range(vec.begin(), vec.end(),
+        iterator::pred::const_call([threshold](int v){ return v >= threshold && v % 3 != 0; }));
+    using namespace iterator::dsl;
+    auto kernel = iterator::filter_range(vec.begin(), vec.end(), iterator::pred::const_call(_1 > 2 && _1 < 4000));
+    static_assert(iterator::simd::is_kernel_v<std::vector<int>::iterator, decltype(kernel)::Predicate>);
+    EXPECT_EQ(*kernel.begin(), 3);
+    const auto& cached = kernel;
+
+    constexpr int threads = 32;
+    std::atomic<int> mismatches{0};
+    std::vector<std::thread> workers;
+    for (int t = 0; t < threads; ++t) {
+        workers.emplace_back([&, t] {
+            for (int round = 0; round < 20; ++round) {
+                std::vector<int> result(copied.begin(), copied.end());
+                mismatches += result != expected;
+                mismatches += !std::ranges::equal(shared, expected);
+                auto it = std::ranges::next(cached.begin(), t);
+                mismatches += *it != t + 3;
+                mismatches += std::ranges::distance(cached.begin(), cached.end()) != 3997;
+            }
+        });
+    }
+    for (auto& worker : workers) {
+        worker.join();
+    }
+    EXPECT_EQ(mismatches.load(), 0);
+    EXPECT_EQ(std::get<0>(copied.pred().pred.preds).get(), 0);
+
+    // copying a per_iterator predicate into the end iterator may throw
+    struct ThrowingCopy {
+        bool armed = false;
+        explicit ThrowingCopy(bool arm): armed(arm) {}
+        ThrowingCopy(const ThrowingCopy& other): armed(other.armed) {
+            if (armed) {
+                throw std::runtime_error("copy");
+            }
+        }
+        ThrowingCopy(ThrowingCopy&&) noexcept = default;
+        ThrowingCopy& operator=(const ThrowingCopy&) = default;
+        bool operator()(int v) const { return v > 2; }
+    };
+    auto throwing = iterator::filter_range(vec.begin(), vec.end(), iterator::pred::per_iterator(ThrowingCopy(false)));
+    static_assert(!noexcept(throwing.end()) && !noexcept(std::as_const(throwing).end()));
+    static_assert(noexcept(std::as_const(shared).end()) && noexcept(kernel.end()));
+    EXPECT_EQ(*throwing.begin(), 3);
+    auto throwing_armed = iterator::filter_range(vec.begin(), vec.end(), iterator::pred::per_iterator(ThrowingCopy(true)));
+    EXPECT_THROW(static_cast<void>(std::as_const(throwing_armed).end()), std::runtime_error);
+}
+
+TEST(FilterIteratorTypedTest, CachedBegin) {
+    std::vector vec = {1,2,3,4,5,6};
+    MyComp Comp{};
+    auto range = iterator::filter_range(vec.begin(), vec.end(), std::ref(Comp));
+    EXPECT_EQ(*range.begin(), 3);
+    EXPECT_EQ(Comp.get(), 3);
+    EXPECT_EQ(*range.begin(), 3);
+    EXPECT_EQ(range.begin(), range.begin());
+    EXPECT_EQ(Comp.get(), 3);
+
+    vec[0] = 10;
+    EXPECT_EQ(*range.begin(), 3);
+    range.invalidate();
+    EXPECT_EQ(*range.begin(), 10);
+    EXPECT_EQ(Comp.get(), 4);
+}
+
+TEST(FilterIteratorTypedTest, SizeAndEmpty) {
+    std::vector vec = {1,2,3,4,5,6};
+    MyComp Comp{};
+    auto range = iterator::filter_range(vec.begin(), vec.end(), std::ref(Comp));
+    EXPECT_FALSE(range.empty());
+    EXPECT_EQ(Comp.get(), 3);
+    EXPECT_EQ(range.size(), 4u);
+    EXPECT_EQ(Comp.get(), 6);
+    EXPECT_EQ(range.size(), 4u);
+    EXPECT_EQ(std::ranges::size(range), 4u);
+    EXPECT_EQ(Comp.get(), 6);
+
+    vec[0] = 10;
+    range.invalidate();
+    EXPECT_EQ(range.size(), 5u);
+    EXPECT_EQ(Comp.get(), 12);
+
+    vec = {0,1,2};
+    MyComp None{};
+    auto nothing = iterator::filter_range(vec.begin(), vec.end(), std::ref(None));
+    EXPECT_TRUE(nothing.empty());
+    EXPECT_EQ(nothing.size(), 0u);
+    EXPECT_EQ(None.get(), 3);
+
+    std::vector<int> big(1000);
+    std::iota(big.begin(), big.end(), 0);
+    auto kernel = iterator::filter_range(big.begin(), big.end(), iterator::pred::greater(900));
+    EXPECT_EQ(kernel.size(), 99u);
+    auto unrepresentable = iterator::filter_range(big.begin(), big.end(), iterator::pred::greater(-1e12));
+    EXPECT_EQ(unrepresentable.size(), 1000u);
+    std::list<int> list(big.begin(), big.end());
+    EXPECT_EQ(iterator::filter_range(list.begin(), list.end(), iterator::pred::greater(900)).size(), 99u);
+}
+
+// Single-pass reader that counts how often it is copied and how many elements it reads.
+struct CountingReader {
+    using value_type = int;
+    using reference = const int&;
+    using pointer = const int*;
+    using difference_type = std::ptrdiff_t;
+    using iterator_category = std::input_iterator_tag;
+
+    CountingReader() = default;
+    CountingReader(const std::vector<int>* values, std::size_t at, int* copied, int* read): data(values), pos(at), copies(copied), reads(read) {}
+    CountingReader(const CountingReader& other): data(other.data), pos(other.pos), copies(other.copies), reads(other.reads) {
+        if (copies) {
+            ++*copies;
+        }
+    }
+    CountingReader(CountingReader&&) = default;
+    CountingReader& operator=(const CountingReader&) = default;
+    CountingReader& operator=(CountingReader&&) = default;
+
+    reference operator*() const {
+        ++*reads;
+        return (*data)[pos];
+    }
+    CountingReader& operator++() {
+        ++pos;
+        return *this;
+    }
+    void operator++(int) {++pos;}
+    bool operator==(const CountingReader& other) const {return pos == other.pos;}
+
+    const std::vector<int>* data = nullptr;
+    std::size_t pos = 0;
+    int* copies = nullptr;
+    int* reads = nullptr;
+};
+
+TEST(FilterIteratorTypedTest, SinglePassInput) {
+    std::istringstream in("1 7 3 9 4 12 0 8");
+    auto pred = [](int v){ return v > 5; };
+    auto range = iterator::filter_range(std::istream_iterator<int>(in), std::istream_iterator<int>(), pred);
+    static_assert(std::ranges::input_range<decltype(range)> && !std::ranges::forward_range<decltype(range)>);
+    static_assert(std::is_same_v<decltype(range)::iterator::iterator_category, std::input_iterator_tag>);
+    EXPECT_FALSE(range.empty());
+    EXPECT_EQ(*range.begin(), 7);
+    std::vector<int> result(range.begin(), range.end());
+    EXPECT_EQ(result, (std::vector<int>{7, 9, 12, 8}));
+    EXPECT_TRUE(range.empty());
+
+    std::istringstream words("error disk full\ninfo ok\nerror net down\n");
+    std::vector<std::string> errors;
+    auto lines = iterator::filter_range(std::istream_iterator<std::string>(words), std::default_sentinel,
+        [](const std::string& w){ return w == "error"; });
+    for (const auto& w : lines) {
+        errors.push_back(w);
+    }
+    EXPECT_EQ(errors.size(), 2u);
+
+    std::istringstream numbers("5 6 7 8 9 10");
+    auto piped = std::ranges::subrange(std::istream_iterator<int>(numbers), std::istream_iterator<int>())
+        | iterator::views::filter([](int v){ return v % 2 == 0; });
+    std::vector<int> even;
+    std::ranges::copy(piped, std::back_inserter(even));
+    EXPECT_EQ(even, (std::vector<int>{6, 8, 10}));
+
+    std::vector<int> data = {1, 9, 2, 8, 3, 7, 6, 0};
+    int copies = 0;
+    int reads = 0;
+    auto counted = iterator::filter_range(CountingReader(&data, 0, &copies, &reads), CountingReader(&data, data.size(), &copies, &reads), pred);
+    copies = 0;
+    std::vector<int> kept;
+    for (auto it = counted.begin(); it != counted.end(); ++it) {
+        kept.push_back(*it);
+    }
+    EXPECT_EQ(kept, (std::vector<int>{9, 8, 7, 6}));
+    EXPECT_EQ(copies, 0);
+    // one read per element for the predicate and one per match for the loop body
+    EXPECT_EQ(reads, 12);
+}
+
+struct MappedRecord {
+    int id;
+    float value;
+};
+
+// Writes bytes to a file in the temporary directory that is removed with the object.
+struct TempFile {
+    TempFile(const std::string& name, const void* bytes, std::size_t size)
+        : path(std::filesystem::temp_directory_path() / ("filteriterator_" + name + "_" + std::to_string(std::random_device{}()))) {
+        std::ofstream out(path, std::ios::binary);
+        out.write(static_cast<const char*>(bytes), static_cast<std::streamsize>(size));
+    }
+    ~TempFile() {
+        std::error_code ignored;
+        std::filesystem::remove(path, ignored);
+    }
+
+    std::filesystem::path path;
+};
+
+TEST(FilterIteratorTypedTest, MmapRecordRange) {
+    std::vector<MappedRecord> records;
+    for (int i = 0; i < 1000; ++i) {
+        records.push_back({i, static_cast<float>(i) / 2});
+    }
+    TempFile file("records", records.data(), records.size() * sizeof(MappedRecord));
+    iterator::mmap_record_range<MappedRecord> mapped(file.path, {.sequential = true, .will_need = true, .huge_pages = true});
+    static_assert(std::ranges::contiguous_range<decltype(mapped)>);
+    ASSERT_EQ(mapped.size(), records.size());
+    auto range = iterator::filter_range(mapped.begin(), mapped.end(), [](const MappedRecord& r){ return r.id % 3 == 0; });
+    std::vector<int> ids;
+    for (const auto& r : range) {
+        ids.push_back(r.id);
+        EXPECT_EQ(r.value, static_cast<float>(r.id) / 2);
+    }
+    EXPECT_EQ(ids.size(), 334u);
+    EXPECT_EQ(ids.back(), 999);
+
+    auto moved = std::move(mapped);
+    EXPECT_TRUE(mapped.empty());
+    EXPECT_EQ(moved.size(), records.size());
+
+    std::vector<int> values(4096);
+    std::iota(values.begin(), values.end(), 0);
+    TempFile ints("ints", values.data(), values.size() * sizeof(int) + 2);
+    iterator::mmap_record_range<int> mapped_ints(ints.path);
+    EXPECT_EQ(mapped_ints.size(), values.size());
+    auto big = mapped_ints | iterator::views::filter(iterator::pred::greater(4000));
+    EXPECT_EQ(big.size(), 95u);
+    EXPECT_EQ(*big.begin(), 4001);
+
+    TempFile empty("empty", "", 0);
+    iterator::mmap_record_range<int> nothing(empty.path);
+    EXPECT_TRUE(nothing.empty());
+    EXPECT_EQ(nothing.begin(), nothing.end());
+
+    EXPECT_THROW(iterator::mmap_record_range<int>(std::filesystem::temp_directory_path() / "filteriterator_missing_file"), std::system_error);
+}
+
+TEST(FilterIteratorTypedTest, ReverseScanTouchesTail) {
+    std::vector vec = {1,2,3,4,5,6,7,8,9,10};
+    MyComp Comp{};
+    auto range = iterator::filter_range(vec.begin(), vec.end(), std::ref(Comp));
+    auto it = range.rbegin();
+    EXPECT_EQ(*it, 10);
     ++it;
-    EXPECT_EQ(Comp.get(), 14);
+    EXPECT_EQ(*it, 9);
+    EXPECT_EQ(Comp.get(), 2);
+    EXPECT_EQ(std::distance(range.rbegin(), range.rend()), 8);
+}
+
+TEST(FilterIteratorTypedTest, PredicateCombinators) {
+    std::vector vec = {1,2,3,4,5,6,7,8,9,10};
+    auto even = [](int v){ return v % 2 == 0; };
+    auto small = [](int v){ return v < 5; };
+    auto big = [](int v){ return v > 8; };
+
+    auto conj = iterator::pred::all_of(even, iterator::pred::not_(small));
+    auto disj = iterator::pred::any_of(small, big);
+    std::vector<int> result;
+    std::copy_if(vec.begin(), vec.end(), std::back_inserter(result), conj);
+    EXPECT_EQ(result, (std::vector<int>{6, 8, 10}));
+    result.clear();
+    std::copy_if(vec.begin(), vec.end(), std::back_inserter(result), disj);
+    EXPECT_EQ(result, (std::vector<int>{1, 2, 3, 4, 9, 10}));
+    EXPECT_TRUE(iterator::pred::all_of()(0));
+    EXPECT_FALSE(iterator::pred::any_of()(0));
+
+    using flat = decltype(iterator::pred::all_of(iterator::pred::all_of(even, small), big));
+    static_assert(std::is_same_v<flat, iterator::pred::all_of_t<decltype(even), decltype(small), decltype(big)>>);
+    static_assert(std::is_same_v<decltype(iterator::pred::any_of(disj, even)),
+        iterator::pred::any_of_t<decltype(small), decltype(big), decltype(even)>>);
+    static_assert(std::is_empty_v<decltype(conj)>);
+    static_assert(std::ranges::borrowed_range<decltype(iterator::filter_range(vec.begin(), vec.end(), conj))>);
+
+    // stacking filter_ranges yields one range over vec with both predicates fused
+    MyComp Comp{};
+    auto inner = iterator::filter_range(vec.begin(), vec.end(), std::ref(Comp));
+    auto fused = iterator::filter_range(inner.begin(), inner.end(), even);
+    static_assert(std::is_same_v<decltype(fused)::iterator::pointer, int*>);
+    static_assert(std::is_same_v<decltype(fused), iterator::filter_range<std::vector<int>::iterator,
+        iterator::pred::all_of_t<std::reference_wrapper<MyComp>, decltype(even)>>>);
+    EXPECT_TRUE(std::ranges::equal(fused, std::vector{4, 6, 8, 10}));
+    EXPECT_EQ(Comp.get(), 3 + 8);
+
+    int threshold = 3;
+    auto piped = vec | iterator::views::filter([threshold](int v){ return v > threshold; }) | iterator::views::filter(even);
+    static_assert(std::is_same_v<decltype(piped)::iterator::pointer, int*>);
+    EXPECT_TRUE(std::ranges::equal(piped, std::vector{4, 6, 8, 10}));
+}
+
+TEST(FilterIteratorTypedTest, AdaptiveConjunction) {
+    std::vector<int> data;
+    std::mt19937 gen(7);
+    std::uniform_int_distribution<> distrib(0, 999);
+    for (int i = 0; i < 20000; ++i) {
+        data.push_back(distrib(gen));
+    }
+    auto slow = [](int v) {
+        volatile int sink = 0;
+        for (int i = 0; i < 200; ++i) {
+            sink = sink + i;
+        }
+        return v >= 0;
+    };
+    auto half = [](int v){ return v < 500; };
+    auto rare = [](int v){ return v % 10 == 0; };
+    std::vector<int> expected;
+    std::copy_if(data.begin(), data.end(), std::back_inserter(expected), iterator::pred::all_of(slow, half, rare));
+
+    auto range = iterator::filter_range(data.begin(), data.end(), iterator::pred::adaptive_all_of<1024>(slow, half, rare));
+    EXPECT_EQ(range.pred().order(), (std::array<std::size_t, 3>{0, 1, 2}));
+    std::vector<int> result(range.begin(), range.end());
     EXPECT_EQ(result, expected);
+    // the term that never rejects is moved behind the others
+    EXPECT_EQ(range.pred().order().back(), 0u);
+    range.invalidate();
+    EXPECT_TRUE(std::ranges::equal(range, expected));
+
+    // both terms reject half of the elements, so the cheaper one per rejection goes first
+    auto slow_half = [&slow](int v){ return slow(v) && v < 500; };
+    auto even = [](int v){ return v % 2 == 0; };
+    auto ranked = iterator::pred::adaptive_all_of<16384>(slow_half, even);
+    EXPECT_EQ(ranked.order(), (std::array<std::size_t, 2>{0, 1}));
+    for (std::size_t i = 0; i < 16384; ++i) {
+        EXPECT_EQ(ranked(data[i]), slow_half(data[i]) && even(data[i]));
+    }
+    EXPECT_EQ(ranked.order(), (std::array<std::size_t, 2>{1, 0}));
+}
+
+TEST(FilterIteratorTypedTest, ScanStats) {
+    std::vector vec = {1, 5, 2, 2, 2, 7, 3, 9};
+    auto big = [](int v){ return v > 4; };
+    iterator::scan_stats stats;
+    auto range = iterator::filter_range(vec.begin(), vec.end(), big, stats);
+    static_assert(std::is_same_v<decltype(range)::iterator,
+        iterator::Impl::filter_iterator<std::vector<int>::iterator, decltype(big), std::vector<int>::iterator, iterator::scan_stats>>);
+    std::vector<int> result;
+    for (int v : range) {
+        result.push_back(v);
+    }
+    EXPECT_EQ(result, (std::vector<int>{5, 7, 9}));
+    EXPECT_EQ(stats.predicate_calls, 8u);
+    EXPECT_EQ(stats.scanned, 8u);
+    EXPECT_EQ(stats.matches, 3u);
+    EXPECT_EQ(stats.skip_histogram[1], 2u);
+    EXPECT_EQ(stats.skip_histogram[2], 1u);
+
+    iterator::scan_stats reverse;
+    auto backwards = iterator::filter_range(vec.begin(), vec.end(), big, reverse);
+    EXPECT_EQ(std::distance(backwards.rbegin(), backwards.rend()), 3);
+    EXPECT_EQ(reverse.predicate_calls, 8u);
+    EXPECT_EQ(reverse.matches, 3u);
+    EXPECT_EQ(reverse.skip_histogram[0], 1u);
+
+    // a range shorter than a block is scanned by calling the kernel predicate
+    iterator::scan_stats kernel;
+    auto simd = iterator::filter_range(vec.begin(), vec.end(), iterator::pred::greater(4), kernel);
+    std::vector<int> simd_result;
+    for (int v : simd) {
+        simd_result.push_back(v);
+    }
+    EXPECT_EQ(simd_result, (std::vector<int>{5, 7, 9}));
+    EXPECT_EQ(kernel.predicate_calls, 8u);
+    EXPECT_EQ(kernel.scanned, 8u);
+    EXPECT_EQ(kernel.matches, 3u);
+
+    // elements decided by a block mask are scanned without calling it, only the tail is
+    std::vector<int> blocks(70);
+    for (std::size_t i = 0; i < blocks.size(); ++i) {
+        blocks[i] = static_cast<int>(i % 10);
+    }
+    iterator::scan_stats tail;
+    auto masked = iterator::filter_range(blocks.begin(), blocks.end(), iterator::pred::less(5), tail);
+    EXPECT_EQ(std::distance(masked.begin(), masked.end()), 35);
+    EXPECT_EQ(tail.predicate_calls, 6u);
+    EXPECT_EQ(tail.scanned, 70u);
+    EXPECT_EQ(tail.matches, 35u);
+    iterator::scan_stats tail_selected;
+    auto masked_selected = iterator::filter_range(blocks.begin(), blocks.end(), iterator::pred::less(5), tail_selected);
+    EXPECT_EQ(masked_selected.select_indices().size(), 35u);
+    EXPECT_EQ(tail_selected.predicate_calls, 6u);
+
+    // select_indices records the same scan as iterating
+    iterator::scan_stats selected;
+    auto indexed = iterator::filter_range(vec.begin(), vec.end(), big, selected);
+    EXPECT_EQ(indexed.select_indices(), (std::vector<std::uint32_t>{1, 5, 7}));
+    EXPECT_EQ(selected.predicate_calls, stats.predicate_calls);
+    EXPECT_EQ(selected.scanned, stats.scanned);
+    EXPECT_EQ(selected.matches, stats.matches);
+    EXPECT_EQ(selected.skip_histogram, stats.skip_histogram);
+    iterator::scan_stats selected_kernel;
+    auto indexed_kernel = iterator::filter_range(vec.begin(), vec.end(), iterator::pred::greater(4), selected_kernel);
+    EXPECT_EQ(indexed_kernel.select_indices(), (std::vector<std::uint32_t>{1, 5, 7}));
+    EXPECT_EQ(selected_kernel.predicate_calls, 8u);
+    EXPECT_EQ(selected_kernel.scanned, 8u);
+    EXPECT_EQ(selected_kernel.matches, 3u);
+    EXPECT_EQ(selected_kernel.skip_histogram, stats.skip_histogram);
+
+    // size() records the same full scan as select_indices
+    iterator::scan_stats counted;
+    auto sized = iterator::filter_range(vec.begin(), vec.end(), big, counted);
+    EXPECT_EQ(sized.size(), 3u);
+    EXPECT_EQ(counted.predicate_calls, selected.predicate_calls);
+    EXPECT_EQ(counted.scanned, selected.scanned);
+    EXPECT_EQ(counted.matches, selected.matches);
+    EXPECT_EQ(counted.skip_histogram, selected.skip_histogram);
+    iterator::scan_stats counted_kernel;
+    auto sized_kernel = iterator::filter_range(vec.begin(), vec.end(), iterator::pred::greater(4), counted_kernel);
+    EXPECT_EQ(sized_kernel.size(), 3u);
+    EXPECT_EQ(counted_kernel.predicate_calls, selected_kernel.predicate_calls);
+    EXPECT_EQ(counted_kernel.scanned, selected_kernel.scanned);
+    EXPECT_EQ(counted_kernel.matches, selected_kernel.matches);
+    EXPECT_EQ(counted_kernel.skip_histogram, selected_kernel.skip_histogram);
+
+    // fusing keeps recording into the inner range's sink
+    iterator::scan_stats fused_stats;
+    auto inner = iterator::filter_range(vec.begin(), vec.end(), big, fused_stats);
+    auto odd = [](int v){ return v % 2 == 1; };
+    auto fused = iterator::filter_range(inner.begin(), inner.end(), odd);
+    static_assert(std::is_same_v<decltype(fused)::stats_type, iterator::scan_stats>);
+    auto calls = fused_stats.predicate_calls;
+    EXPECT_TRUE(std::ranges::equal(fused, std::vector{5, 7, 9}));
+    // the fused range starts at inner's first match, the 7 elements from 5 on
+    EXPECT_EQ(fused_stats.predicate_calls - calls, 7u);
+    auto piped = inner | iterator::views::filter([](int v){ return v < 8; });
+    static_assert(std::is_same_v<decltype(piped)::stats_type, iterator::scan_stats>);
+    auto matches = fused_stats.matches;
+    EXPECT_TRUE(std::ranges::equal(piped, std::vector{5, 7}));
+    EXPECT_EQ(fused_stats.matches - matches, 2u);
+
+    // the disabled policy takes no space
+    int threshold = 4;
+    auto plain = iterator::filter_range(vec.begin(), vec.end(), [threshold](int v){ return v > threshold; });
+    static_assert(sizeof(decltype(plain)::iterator) == 3 * sizeof(std::vector<int>::iterator) + sizeof(void*));
+    static_assert(sizeof(decltype(range)::iterator) == 4 * sizeof(std::vector<int>::iterator));
+    static_assert(sizeof(iterator::Impl::filter_iterator<int*, decltype(big)>) == 3 * sizeof(int*));
+    static_assert(sizeof(iterator::filter_range<int*, decltype(big)>) == sizeof(iterator::filter_range<int*, decltype(big), int*, iterator::no_stats>));
+    static_assert(sizeof(iterator::filter_range<int*, decltype(big), int*, iterator::scan_stats>) == sizeof(iterator::filter_range<int*, decltype(big)>) + sizeof(void*));
+}
+
+TEST(FilterIteratorTypedTest, PrefetchNodeBased) {
+    std::list<int> data;
+    for (int i = 0; i < 5000; ++i) {
+        data.push_back((i * 37) % 101);
+    }
+    auto pred = [](int v){ return v > 60; };
+    std::vector<int> expected;
+    std::copy_if(data.begin(), data.end(), std::back_inserter(expected), pred);
+
+    for (std::size_t distance : {iterator::prefetch_auto, std::size_t{1}, std::size_t{3}, std::size_t{64}, std::size_t{1000}}) {
+        iterator::prefetch_range prefetched(data.begin(), data.end(), distance);
+        auto range = iterator::filter_range(prefetched.begin(), prefetched.end(), pred);
+        std::vector<int> result(range.begin(), range.end());
+        EXPECT_EQ(result, expected) << distance;
+        EXPECT_LE(prefetched.begin().distance(), 64u);
+    }
+
+    auto piped = data | iterator::views::prefetch(4) | iterator::views::filter(pred);
+    EXPECT_TRUE(std::ranges::equal(piped, expected));
+
+    std::map<int, std::string> names = {{1, "one"}, {2, "two"}, {3, "three"}, {4, "four"}};
+    auto long_names = names | iterator::views::prefetch() | iterator::views::filter([](const auto& entry){ return entry.second.size() > 3; });
+    std::vector<int> keys;
+    for (const auto& [key, name] : long_names) {
+        keys.push_back(key);
+    }
+    EXPECT_EQ(keys, (std::vector<int>{3, 4}));
+
+    std::forward_list<int> empty;
+    auto nothing = empty | iterator::views::prefetch(2) | iterator::views::filter(pred);
+    EXPECT_TRUE(nothing.begin() == nothing.end());
 }
 
 int main(int argc, char **argv) {